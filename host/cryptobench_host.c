@@ -0,0 +1,31 @@
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+#include <gccore.h>
+
+#include "cryptobench.h"
+#include "sha_hw.h"
+
+#define HOST_BENCHMARK_BUF_SIZE     0x400000    // Matches the largest throughput run.
+
+/* Runs the same crypto known answer tests and throughput runs as a "make BENCHMARK=1" build, using the software implementations only. */
+/* Results are saved as CSV to the path provided as the first argument, if any. Returns a non-zero exit code if any known answer test fails. */
+int main(int argc, char **argv)
+{
+    bool success = RunCryptoKnownAnswerTests();
+    if (!success) printf("One or more known answer tests failed!\n\n");
+
+    u8 *buf = memalign(SHA_HW_ALIGNMENT, HOST_BENCHMARK_BUF_SIZE);
+    if (!buf)
+    {
+        printf("Failed to allocate memory for the throughput tests!\n");
+        return EXIT_FAILURE;
+    }
+
+    RunCryptoThroughputTests(buf, HOST_BENCHMARK_BUF_SIZE);
+    free(buf);
+
+    if (argc > 1) printf("Saving results to \"%s\"... %s\n", argv[1], SaveCryptoBenchmarkResults(argv[1]) ? "OK!" : "FAILED!");
+
+    return (success ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -0,0 +1,51 @@
+#---------------------------------------------------------------------------------
+# Host builds of the portable parts of the project, using the system compiler
+# instead of devkitPPC. libogc is replaced by the minimal headers from host/include
+#
+# host-cryptobench runs the crypto known answer tests and throughput runs from
+# "make BENCHMARK=1" builds against the software AES, SHA-1 and XXH32 code. The
+# hardware engines are stubbed out as unavailable (see host/hw_stub.c). Results
+# are saved to $(HOST_BUILD)/benchmark.csv
+#
+# host-mmio-test runs the OTP, SEEPROM, boot0 and vWii SRAM OTP readers on top of
+# the simulated register file from source/mmio_host.c, and checks their output
+# and register access counts against known device images (see host/mmio_test.c).
+# The AES and SHA engine drivers are checked against aes.c and sha1.c as well
+#---------------------------------------------------------------------------------
+HOST_CC		?=	cc
+HOST_BUILD	:=	build_host
+
+HOST_CFLAGS	=	-std=gnu11 -g -Wall -Werror -O2 -I$(CURDIR)/host/include -iquote $(CURDIR)/source
+
+# "make host-cryptobench AES_SMALL_TABLES=1" checks the compact AES table variant instead
+ifeq ($(strip $(AES_SMALL_TABLES)),1)
+HOST_CFLAGS	+=	-DAES_SMALL_TABLES
+endif
+
+HOST_HEADERS	:=	$(wildcard source/*.h) $(shell find host/include -name '*.h')
+
+HOST_CRYPTOBENCH_CFILES	:=	source/aes.c source/sha1.c source/xxhash.c source/cryptobench.c \
+							host/hw_stub.c host/cryptobench_host.c
+
+HOST_MMIO_TEST_CFILES	:=	source/mmio_host.c source/blockdev.c source/otp.c source/mini_seeprom.c source/boot0.c \
+							source/vwii_sram_otp.c source/aes.c source/aes_hw.c source/sha1.c source/sha_hw.c host/mmio_test.c
+
+.PHONY: host-cryptobench host-mmio-test host-clean
+
+host-cryptobench: $(HOST_BUILD)/cryptobench
+	$(HOST_BUILD)/cryptobench $(HOST_BUILD)/benchmark.csv
+
+$(HOST_BUILD)/cryptobench: $(HOST_CRYPTOBENCH_CFILES) $(HOST_HEADERS)
+	@[ -d $(HOST_BUILD) ] || mkdir -p $(HOST_BUILD)
+	$(HOST_CC) $(HOST_CFLAGS) -DXYZZY_BENCHMARK -o $@ $(HOST_CRYPTOBENCH_CFILES)
+
+host-mmio-test: $(HOST_BUILD)/mmio_test
+	$(HOST_BUILD)/mmio_test
+
+$(HOST_BUILD)/mmio_test: $(HOST_MMIO_TEST_CFILES) $(HOST_HEADERS)
+	@[ -d $(HOST_BUILD) ] || mkdir -p $(HOST_BUILD)
+	$(HOST_CC) $(HOST_CFLAGS) -DXYZZY_HOST_MMIO -o $@ $(HOST_MMIO_TEST_CFILES)
+
+host-clean:
+	@echo clean host ...
+	@rm -fr $(HOST_BUILD)
@@ -0,0 +1,30 @@
+#include <gctypes.h>
+
+#include "aes_hw.h"
+#include "sha_hw.h"
+
+/* Host builds have no AES or SHA engine, so both report themselves as unavailable and every caller sticks to the software implementations */
+
+void aes_hw_init(void) {}
+void aes_hw_hold(void) {}
+void aes_hw_release(void) {}
+bool aes_hw_held(void) { return false; }
+bool aes_hw_available(void) { return false; }
+
+bool aes_hw_cbc(const u8 *key, const u8 *iv, const u8 *src, u8 *dst, u32 size, bool enc, u8 *out_iv)
+{
+    (void)key; (void)iv; (void)src; (void)dst; (void)size; (void)enc; (void)out_iv;
+    return false;
+}
+
+void sha_hw_init(void) {}
+void sha_hw_hold(void) {}
+void sha_hw_release(void) {}
+bool sha_hw_held(void) { return false; }
+bool sha_hw_available(void) { return false; }
+
+bool sha_hw_process_blocks(u32 *state, const u8 *data, u32 blocks)
+{
+    (void)state; (void)data; (void)blocks;
+    return false;
+}
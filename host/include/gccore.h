@@ -0,0 +1,37 @@
+#ifndef __GCCORE_H__
+#define __GCCORE_H__
+
+/* Host stand-in for the libogc header of the same name. Only covers what the portable sources (and the headers they include) use. */
+
+#include <stdio.h>
+#include <gctypes.h>
+
+/* ES types, as used by tools.h and the SHA-1 callers */
+typedef u8 sha1[20];
+typedef u32 signed_blob;
+typedef struct _tmd tmd;
+
+#define ES_SIG_RSA4096          0x10000
+#define ES_SIG_RSA2048          0x10001
+#define ES_SIG_ECDSA            0x10002
+
+#define IS_VALID_SIGNATURE(x)   ((((*(x)) & ~0xFFFF) == 0x10000) && (((*(x)) & 0xFFFF) <= 2))
+#define SIGNATURE_SIZE(x)       ((*(x)) == ES_SIG_RSA4096 ? 0x240 : ((*(x)) == ES_SIG_RSA2048 ? 0x140 : ((*(x)) == ES_SIG_ECDSA ? 0x80 : 0)))
+
+/* Host memory is coherent, so cache maintenance is a no-op */
+static inline void DCFlushRange(void *startaddress, u32 len) { (void)startaddress; (void)len; }
+static inline void DCStoreRange(void *startaddress, u32 len) { (void)startaddress; (void)len; }
+static inline void DCInvalidateRange(void *startaddress, u32 len) { (void)startaddress; (void)len; }
+static inline void ICInvalidateRange(void *startaddress, u32 len) { (void)startaddress; (void)len; }
+
+/* Host builds are single-threaded, so mutexes don't need to do anything */
+typedef u32 mutex_t;
+
+#define LWP_MUTEX_NULL          0xFFFFFFFF
+
+static inline s32 LWP_MutexInit(mutex_t *mutex, bool use_recursive) { (void)use_recursive; *mutex = 0; return 0; }
+static inline s32 LWP_MutexDestroy(mutex_t mutex) { (void)mutex; return 0; }
+static inline s32 LWP_MutexLock(mutex_t mutex) { (void)mutex; return 0; }
+static inline s32 LWP_MutexUnlock(mutex_t mutex) { (void)mutex; return 0; }
+
+#endif /* __GCCORE_H__ */
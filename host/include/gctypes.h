@@ -0,0 +1,31 @@
+#ifndef __GCTYPES_H__
+#define __GCTYPES_H__
+
+/* Host stand-in for the libogc header of the same name. Only covers what the portable sources use. */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef uint8_t     u8;
+typedef uint16_t    u16;
+typedef uint32_t    u32;
+typedef uint64_t    u64;
+
+typedef int8_t      s8;
+typedef int16_t     s16;
+typedef int32_t     s32;
+typedef int64_t     s64;
+
+typedef volatile u8     vu8;
+typedef volatile u16    vu16;
+typedef volatile u32    vu32;
+typedef volatile u64    vu64;
+
+typedef float       f32;
+typedef double      f64;
+
+#define ATTRIBUTE_ALIGN(v)  __attribute__((aligned(v)))
+#define ATTRIBUTE_PACKED    __attribute__((packed))
+
+#endif /* __GCTYPES_H__ */
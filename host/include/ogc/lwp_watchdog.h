@@ -0,0 +1,32 @@
+#ifndef __LWP_WATCHDOG_H__
+#define __LWP_WATCHDOG_H__
+
+/* Host stand-in for the libogc header of the same name. The timebase is replaced by the monotonic clock, with one tick per nanosecond. */
+
+#include <time.h>
+#include <gctypes.h>
+
+#define ticks_to_secs(ticks)            ((u64)(ticks) / 1000000000ULL)
+#define ticks_to_millisecs(ticks)       ((u64)(ticks) / 1000000ULL)
+#define ticks_to_microsecs(ticks)       ((u64)(ticks) / 1000ULL)
+#define ticks_to_nanosecs(ticks)        ((u64)(ticks))
+
+#define secs_to_ticks(sec)              ((u64)(sec) * 1000000000ULL)
+#define millisecs_to_ticks(msec)        ((u64)(msec) * 1000000ULL)
+#define microsecs_to_ticks(usec)        ((u64)(usec) * 1000ULL)
+#define nanosecs_to_ticks(nsec)         ((u64)(nsec))
+
+static inline u64 gettime(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((u64)ts.tv_sec * 1000000000ULL + (u64)ts.tv_nsec);
+}
+
+static inline u64 diff_ticks(u64 start, u64 end) { return (end - start); }
+static inline u32 diff_sec(u64 start, u64 end) { return (u32)ticks_to_secs(end - start); }
+static inline u32 diff_msec(u64 start, u64 end) { return (u32)ticks_to_millisecs(end - start); }
+static inline u32 diff_usec(u64 start, u64 end) { return (u32)ticks_to_microsecs(end - start); }
+static inline u32 diff_nsec(u64 start, u64 end) { return (u32)ticks_to_nanosecs(end - start); }
+
+#endif /* __LWP_WATCHDOG_H__ */
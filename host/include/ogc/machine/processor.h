@@ -0,0 +1,9 @@
+#ifndef __PROCESSOR_H__
+#define __PROCESSOR_H__
+
+/* Host stand-in for the libogc header of the same name. Host builds reach hardware registers through the simulated MMIO layer */
+/* (see source/mmio_host.c), which also provides _CPU_ISR_Disable() and _CPU_ISR_Restore(). */
+
+#include <gctypes.h>
+
+#endif /* __PROCESSOR_H__ */
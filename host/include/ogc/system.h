@@ -0,0 +1,16 @@
+#ifndef __SYSTEM_H__
+#define __SYSTEM_H__
+
+/* Host stand-in for the libogc header of the same name. Only covers the address translation macros. Nothing reaches real hardware from a */
+/* host build, so these only need to keep regular (non XYZZY_HOST_MMIO) builds of the portable sources compiling. */
+
+#include <gctypes.h>
+
+#define SYS_BASE_CACHED                 0x80000000
+#define SYS_BASE_UNCACHED               0xC0000000
+
+#define MEM_VIRTUAL_TO_PHYSICAL(x)      ((u32)((uintptr_t)(x) & ~SYS_BASE_UNCACHED))
+#define MEM_PHYSICAL_TO_K0(x)           ((void*)(uintptr_t)((u32)(x) + SYS_BASE_CACHED))
+#define MEM_PHYSICAL_TO_K1(x)           ((void*)(uintptr_t)((u32)(x) + SYS_BASE_UNCACHED))
+
+#endif /* __SYSTEM_H__ */
@@ -0,0 +1,6 @@
+#ifndef __WPAD_H__
+#define __WPAD_H__
+
+/* Host stand-in for the libogc header of the same name. Nothing from it is used by the portable sources. */
+
+#endif /* __WPAD_H__ */
@@ -0,0 +1,528 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <gccore.h>
+
+#include "tools.h"
+#include "otp.h"
+#include "mini_seeprom.h"
+#include "boot0.h"
+#include "vwii_sram_otp.h"
+#include "aes.h"
+#include "aes_hw.h"
+#include "sha1.h"
+#include "sha_hw.h"
+
+/* Checks the OTP, SEEPROM, boot0 and vWii SRAM OTP readers against the simulated register file from mmio_host.c. Every device is loaded */
+/* with a known image first, then each reader's output is compared against it, along with the register accesses it took to get there. */
+/* The AES and SHA engine drivers are checked against the software implementations from aes.c and sha1.c as well. */
+
+/* Read by boot0_read() to pick the boot0 size */
+bool g_isvWii = false;
+
+#define SRAM_OTP_OFFSET             0x7F00
+
+/* Per-block register access costs, derived from the readers' bit-banging and gating sequences. mmio_mask32() counts as one read and one write. */
+#define OTP_BLOCK_READS             1       // HW_OTP_DATA.
+#define OTP_BLOCK_WRITES            1       // HW_OTP_COMMAND.
+
+#define SEEPROM_CMD_BITS            11
+#define SEEPROM_WORD_BITS           16
+#define SEEPROM_WORDS               (SEEPROM_SIZE / 2)
+
+#define SEEPROM_SEND_BIT_MASKS      3       // MOSI, clock high, clock low.
+#define SEEPROM_RECV_BIT_MASKS      2       // Clock high, clock low, followed by a single HW_GPIO1IN read.
+#define SEEPROM_SETUP_MASKS         2       // Clock low and CS low before the command cycle.
+
+/* Single READ command cycle covering the provided amount of words: setup, CS high, command, data, CS low */
+#define SEEPROM_READ_MASKS(words)   (SEEPROM_SETUP_MASKS + 1 + (SEEPROM_CMD_BITS * SEEPROM_SEND_BIT_MASKS) + \
+                                     ((words) * SEEPROM_WORD_BITS * SEEPROM_RECV_BIT_MASKS) + 1)
+#define SEEPROM_READ_READS(words)   (SEEPROM_READ_MASKS(words) + ((words) * SEEPROM_WORD_BITS))
+#define SEEPROM_READ_WRITES(words)  SEEPROM_READ_MASKS(words)
+#define SEEPROM_READ_CLOCKS(words)  (SEEPROM_CMD_BITS + ((words) * SEEPROM_WORD_BITS))
+
+/* One delay after the setup, three per command bit, two per data bit and one after CS goes low */
+#define SEEPROM_READ_DELAYS(words)  (1 + (SEEPROM_CMD_BITS * 3) + ((words) * SEEPROM_WORD_BITS * 2) + 1)
+
+#define AES_HW_MAX_BLOCKS           0x80    // Blocks per AES engine command, see aes_hw.c.
+#define SHA_HW_MAX_BLOCKS           0x400   // Blocks per SHA engine command, see sha_hw.c.
+
+#define ENGINE_BUF_SIZE             0x12000
+
+#define CHECK(x) \
+    do { \
+        if (!(x)) \
+        { \
+            printf("\t- %s:%d: check failed: %s.\n", __func__, __LINE__, #x); \
+            failures++; \
+        } \
+    } while(0)
+
+#define CHECK_EQ(a, b) \
+    do { \
+        u64 _a = (u64)(a), _b = (u64)(b); \
+        if (_a != _b) \
+        { \
+            printf("\t- %s:%d: check failed: %s == %s (got %llu, expected %llu).\n", __func__, __LINE__, #a, #b, \
+                   (unsigned long long)_a, (unsigned long long)_b); \
+            failures++; \
+        } \
+    } while(0)
+
+static u32 failures = 0;
+
+static u8 otp_image[OTP_SIZE] = {0};
+static u8 seeprom_image[SEEPROM_SIZE] = {0};
+static u8 boot0_image[BOOT0_WUP_SIZE] = {0};
+static u8 sram_otp_image[SRAM_OTP_SIZE] = {0};
+static u8 sram_image[BOOT0_WUP_SIZE] = {0};
+
+static u8 ATTRIBUTE_ALIGN(SHA_HW_ALIGNMENT) engine_src[ENGINE_BUF_SIZE + SHA_HW_ALIGNMENT] = {0};
+static u8 ATTRIBUTE_ALIGN(SHA_HW_ALIGNMENT) engine_hw[ENGINE_BUF_SIZE + SHA_HW_ALIGNMENT] = {0};
+static u8 ATTRIBUTE_ALIGN(SHA_HW_ALIGNMENT) engine_sw[ENGINE_BUF_SIZE + SHA_HW_ALIGNMENT] = {0};
+static u8 ATTRIBUTE_ALIGN(SHA_HW_ALIGNMENT) engine_dst[ENGINE_BUF_SIZE] = {0};
+
+static void FillImage(u8 *buf, u32 size, u8 mul, u8 add)
+{
+    for(u32 i = 0; i < size; i++) buf[i] = (u8)((i * mul) + add + (i >> 8));
+}
+
+static void LoadImages(void)
+{
+    static const u8 seeprom_ids[] = { 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x01 };
+
+    FillImage(otp_image, sizeof(otp_image), 0x1D, 0x07);
+    FillImage(seeprom_image, sizeof(seeprom_image), 0x3B, 0x11);
+    FillImage(boot0_image, sizeof(boot0_image), 0x65, 0x2F);
+    FillImage(sram_otp_image, sizeof(sram_otp_image), 0x83, 0x49);
+    FillImage(sram_image, sizeof(sram_image), 0xA7, 0x53);
+
+    /* seeprom_calibrate() only accepts SEEPROMs with the expected MS and CA IDs */
+    memcpy(seeprom_image, seeprom_ids, sizeof(seeprom_ids));
+
+    mmio_host_load_otp(otp_image, sizeof(otp_image));
+    mmio_host_load_seeprom(seeprom_image, sizeof(seeprom_image));
+    mmio_host_load_boot0(boot0_image, sizeof(boot0_image));
+    mmio_host_load_sram(0, sram_image, sizeof(sram_image));
+    mmio_host_load_sram(SRAM_OTP_OFFSET, sram_otp_image, sizeof(sram_otp_image));
+
+    mmio_host_reset();
+}
+
+static void TestOtp(void)
+{
+    mmio_host_stats_t stats = {0};
+    u8 buf[OTP_SIZE] = {0};
+
+    mmio_host_reset();
+    CHECK_EQ(otp_read(buf, 0, OTP_SIZE), OTP_SIZE);
+    CHECK(!memcmp(buf, otp_image, OTP_SIZE));
+
+    mmio_host_get_stats(&stats);
+    CHECK_EQ(stats.otp_commands, OTP_SIZE / 4);
+    CHECK_EQ(stats.reads, (OTP_SIZE / 4) * OTP_BLOCK_READS);
+    CHECK_EQ(stats.writes, (OTP_SIZE / 4) * OTP_BLOCK_WRITES);
+
+    /* Unaligned head and tail: 0x13 to 0x2A spans blocks 4 to 10 */
+    memset(buf, 0, sizeof(buf));
+    mmio_host_reset();
+    CHECK_EQ(otp_read(buf, 0x13, 0x18), 0x18);
+    CHECK(!memcmp(buf, otp_image + 0x13, 0x18));
+
+    mmio_host_get_stats(&stats);
+    CHECK_EQ(stats.otp_commands, 7);
+
+    /* Out of bounds */
+    CHECK_EQ(otp_read(buf, 0x7C, 8), 0);
+}
+
+static void TestSeepromRead(void)
+{
+    mmio_host_stats_t stats = {0};
+    u8 buf[SEEPROM_SIZE] = {0};
+
+    seeprom_set_half_period(SEEPROM_DEFAULT_HALF_PERIOD_NS);
+
+    /* The whole SEEPROM goes through a single sequential READ command */
+    mmio_host_reset();
+    CHECK_EQ(seeprom_read(buf, 0, SEEPROM_SIZE), SEEPROM_SIZE);
+    CHECK(!memcmp(buf, seeprom_image, SEEPROM_SIZE));
+
+    mmio_host_get_stats(&stats);
+    CHECK_EQ(stats.seeprom_commands, 1);
+    CHECK_EQ(stats.seeprom_clocks, SEEPROM_READ_CLOCKS(SEEPROM_WORDS));
+    CHECK_EQ(stats.reads, SEEPROM_READ_READS(SEEPROM_WORDS));
+    CHECK_EQ(stats.writes, SEEPROM_READ_WRITES(SEEPROM_WORDS));
+    CHECK_EQ(stats.delay_ns, (u64)SEEPROM_READ_DELAYS(SEEPROM_WORDS) * SEEPROM_DEFAULT_HALF_PERIOD_NS);
+
+    /* Reading one word at a time takes a command per word, which is how the whole SEEPROM used to be dumped */
+    memset(buf, 0, sizeof(buf));
+    mmio_host_reset();
+    for(u32 i = 0; i < SEEPROM_WORDS; i++) CHECK_EQ(seeprom_read(buf + (i * 2), (u16)(i * 2), 2), 2);
+    CHECK(!memcmp(buf, seeprom_image, SEEPROM_SIZE));
+
+    mmio_host_get_stats(&stats);
+    CHECK_EQ(stats.seeprom_commands, SEEPROM_WORDS);
+    CHECK_EQ(stats.seeprom_clocks, SEEPROM_WORDS * SEEPROM_READ_CLOCKS(1));
+    CHECK_EQ(stats.reads + stats.writes, SEEPROM_WORDS * (SEEPROM_READ_READS(1) + SEEPROM_READ_WRITES(1)));
+
+    /* Unaligned range: 0x45 to 0x9A spans words 0x22 to 0x4D */
+    memset(buf, 0, sizeof(buf));
+    mmio_host_reset();
+    CHECK_EQ(seeprom_read(buf, 0x45, 0x56), 0x56);
+    CHECK(!memcmp(buf, seeprom_image + 0x45, 0x56));
+
+    mmio_host_get_stats(&stats);
+    CHECK_EQ(stats.seeprom_commands, 1);
+    CHECK_EQ(stats.seeprom_clocks, SEEPROM_READ_CLOCKS(0x4D - 0x22 + 1));
+
+    /* Out of bounds */
+    CHECK_EQ(seeprom_read(buf, 0xFF, 2), 0);
+}
+
+static void TestSeepromWrite(void)
+{
+    static const u8 data[] = { 0xDE, 0xAD, 0xBE, 0xEF, 0x5A };
+
+    u8 expected[SEEPROM_SIZE] = {0}, buf[SEEPROM_SIZE] = {0};
+
+    memcpy(expected, seeprom_image, SEEPROM_SIZE);
+    memcpy(expected + 0x33, data, sizeof(data));
+
+    /* Unaligned on both ends, so the first and last words get read back before being written */
+    mmio_host_reset();
+    CHECK_EQ(seeprom_write(data, 0x33, sizeof(data)), sizeof(data));
+    CHECK_EQ(seeprom_read(buf, 0, SEEPROM_SIZE), SEEPROM_SIZE);
+    CHECK(!memcmp(buf, expected, SEEPROM_SIZE));
+
+    /* Put the original contents back for the following tests */
+    mmio_host_load_seeprom(seeprom_image, sizeof(seeprom_image));
+}
+
+static void TestSeepromCalibrate(void)
+{
+    mmio_host_stats_t stats = {0};
+    u8 blank[SEEPROM_SIZE] = {0};
+
+    /* The simulated part never misses a clock, so the shortest candidate at or above the minimum is picked */
+    mmio_host_reset();
+    CHECK_EQ(seeprom_calibrate(0), 250);
+    CHECK_EQ(seeprom_get_half_period(), 250);
+
+    /* Reference read at the safe half-period, plus a single candidate read */
+    mmio_host_get_stats(&stats);
+    CHECK_EQ(stats.seeprom_commands, 2);
+    CHECK_EQ(stats.delay_ns, (u64)SEEPROM_READ_DELAYS(SEEPROM_WORDS) * (SEEPROM_SAFE_HALF_PERIOD_NS + 250));
+
+    CHECK_EQ(seeprom_calibrate(SEEPROM_DEFAULT_HALF_PERIOD_NS), SEEPROM_DEFAULT_HALF_PERIOD_NS);
+    CHECK_EQ(seeprom_calibrate(700), SEEPROM_DEFAULT_HALF_PERIOD_NS);
+
+    /* Nothing at or above the minimum is left, so it falls back to the safe half-period */
+    CHECK_EQ(seeprom_calibrate(SEEPROM_SAFE_HALF_PERIOD_NS), SEEPROM_SAFE_HALF_PERIOD_NS);
+
+    /* Unknown SEEPROM contents */
+    mmio_host_load_seeprom(blank, sizeof(blank));
+    mmio_host_reset();
+    CHECK_EQ(seeprom_calibrate(0), 0);
+    CHECK_EQ(seeprom_get_half_period(), SEEPROM_SAFE_HALF_PERIOD_NS);
+
+    mmio_host_load_seeprom(seeprom_image, sizeof(seeprom_image));
+    seeprom_set_half_period(SEEPROM_DEFAULT_HALF_PERIOD_NS);
+}
+
+static void TestBoot0(bool vwii)
+{
+    mmio_host_stats_t stats = {0};
+    u8 buf[BOOT0_WUP_SIZE] = {0};
+    u16 size = (vwii ? BOOT0_WUP_SIZE : BOOT0_RVL_SIZE);
+
+    g_isvWii = vwii;
+
+    mmio_host_reset();
+    CHECK_EQ(boot0_read(buf, 0, size), size);
+    CHECK(!memcmp(buf, boot0_image, size));
+
+    mmio_host_get_stats(&stats);
+    CHECK_EQ(stats.sram_reads, size / 4);
+
+    /* boot0 must be hidden again afterwards, leaving the SRAM contents visible through the mirror */
+    CHECK_EQ(mmio_read32(0xD400000), ((u32)sram_image[0] << 24) | ((u32)sram_image[1] << 16) | ((u32)sram_image[2] << 8) | sram_image[3]);
+
+    /* The SRAM mirror gets enabled for the duration of the read if it was disabled, then disabled again */
+    memset(buf, 0, sizeof(buf));
+    mmio_host_reset();
+    mmio_write32(HW_SRNPROT, 0);
+    CHECK_EQ(boot0_read(buf, 2, 0x21), 0x21);
+    CHECK(!memcmp(buf, boot0_image + 2, 0x21));
+    CHECK_EQ(mmio_read32(HW_SRNPROT), 0);
+
+    /* Past the end of the boot0 size for the current console type */
+    CHECK_EQ(boot0_read(buf, size - 2, 4), 0);
+
+    g_isvWii = false;
+}
+
+static void TestSramOtp(void)
+{
+    mmio_host_stats_t stats = {0};
+    u8 buf[SRAM_OTP_SIZE] = {0};
+
+    mmio_host_reset();
+    CHECK_EQ(vwii_sram_otp_read(buf, 0, SRAM_OTP_SIZE), SRAM_OTP_SIZE);
+    CHECK(!memcmp(buf, sram_otp_image, SRAM_OTP_SIZE));
+
+    mmio_host_get_stats(&stats);
+    CHECK_EQ(stats.sram_reads, SRAM_OTP_SIZE / 4);
+
+    /* Same as boot0: a disabled mirror is only enabled for the duration of the read */
+    memset(buf, 0, sizeof(buf));
+    mmio_host_reset();
+    mmio_write32(HW_SRNPROT, 0);
+    CHECK_EQ(vwii_sram_otp_read(buf, 0x0E, 0x31), 0x31);
+    CHECK(!memcmp(buf, sram_otp_image + 0x0E, 0x31));
+    CHECK_EQ(mmio_read32(HW_SRNPROT), 0);
+
+    /* Out of bounds */
+    CHECK_EQ(vwii_sram_otp_read(buf, 0x7E, 4), 0);
+}
+
+static bool AesHardwareMatchesSoftware(u32 size, bool enc, bool in_place)
+{
+    static const u8 key[AES_BLOCK_SIZE] = { 0x13, 0x37, 0xC0, 0xDE, 0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xAA, 0xBB };
+    static const u8 iv[AES_BLOCK_SIZE]  = { 0xF0, 0xE1, 0xD2, 0xC3, 0xB4, 0xA5, 0x96, 0x87, 0x78, 0x69, 0x5A, 0x4B, 0x3C, 0x2D, 0x1E, 0x0F };
+
+    mmio_host_stats_t stats = {0};
+    u8 out_iv[AES_BLOCK_SIZE] = {0};
+    u8 *dst = (in_place ? engine_hw : engine_dst);
+
+    /* Software reference. Holding the engine keeps aes.c from using it. */
+    memcpy(engine_sw, engine_src, size);
+    aes_hw_hold();
+    bool sw_ok = ((enc ? aes_128_cbc_encrypt(key, iv, engine_sw, size) : aes_128_cbc_decrypt(key, iv, engine_sw, size)) == 0);
+    aes_hw_release();
+    if (!sw_ok) return false;
+
+    memcpy(engine_hw, engine_src, size);
+    mmio_host_reset_stats();
+    if (!aes_hw_cbc(key, iv, engine_hw, dst, size, enc, out_iv) || memcmp(dst, engine_sw, size) != 0) return false;
+
+    /* One command per AES_HW_MAX_BLOCKS blocks, chained to the previous one */
+    mmio_host_get_stats(&stats);
+    if (stats.aes_commands != ALIGN_UP(size / AES_BLOCK_SIZE, AES_HW_MAX_BLOCKS) / AES_HW_MAX_BLOCKS || stats.aes_blocks != size / AES_BLOCK_SIZE) return false;
+
+    /* The output IV must let the next call pick up right where this one left off */
+    return !memcmp(out_iv, (enc ? engine_sw : engine_src) + size - AES_BLOCK_SIZE, AES_BLOCK_SIZE);
+}
+
+static void TestAesEngine(void)
+{
+    static const u32 sizes[] = { 0x10, 0x20, AES_HW_MAX_BLOCKS * AES_BLOCK_SIZE, (AES_HW_MAX_BLOCKS + 1) * AES_BLOCK_SIZE, 0x10000, ENGINE_BUF_SIZE - 0x30 };
+    static const u8 key[AES_BLOCK_SIZE] = {0};
+
+    mmio_host_stats_t stats = {0};
+    u8 iv[AES_BLOCK_SIZE] = {0}, sw_iv[AES_BLOCK_SIZE] = {0};
+    aes_ctx ctx = {0};
+
+    FillImage(engine_src, ENGINE_BUF_SIZE, 0x4D, 0x61);
+
+    /* The driver's own known answer test has to pass through the simulated engine */
+    mmio_host_reset();
+    CHECK(aes_hw_available());
+
+    mmio_host_get_stats(&stats);
+    CHECK_EQ(stats.aes_commands, 2);
+
+    for(u32 i = 0; i < MAX_ELEMENTS(sizes); i++)
+    {
+        CHECK(AesHardwareMatchesSoftware(sizes[i], true, true));
+        CHECK(AesHardwareMatchesSoftware(sizes[i], false, true));
+        CHECK(AesHardwareMatchesSoftware(sizes[i], true, false));
+        CHECK(AesHardwareMatchesSoftware(sizes[i], false, false));
+    }
+
+    /* Two chained calls give the same result as a single one */
+    memcpy(engine_hw, engine_src, 0x3000);
+    CHECK(aes_hw_cbc(key, iv, engine_hw, engine_hw, 0x1000, true, iv));
+    CHECK(aes_hw_cbc(key, iv, engine_hw + 0x1000, engine_hw + 0x1000, 0x2000, true, NULL));
+
+    memcpy(engine_sw, engine_src, 0x3000);
+    aes_hw_hold();
+    CHECK(aes_128_cbc_encrypt(key, sw_iv, engine_sw, 0x3000) == 0);
+    aes_hw_release();
+    CHECK(!memcmp(engine_hw, engine_sw, 0x3000));
+
+    /* aes.c hands aligned buffers over to the engine, and sticks to software for everything else */
+    memcpy(engine_hw, engine_src, 0x1000);
+    mmio_host_reset_stats();
+    CHECK(aes_128_cbc_encrypt(key, sw_iv, engine_hw, 0x1000) == 0);
+    CHECK(!memcmp(engine_hw, engine_sw, 0x1000));
+
+    mmio_host_get_stats(&stats);
+    CHECK_EQ(stats.aes_blocks, 0x1000 / AES_BLOCK_SIZE);
+
+    memcpy(engine_hw + 1, engine_src, 0x1000);
+    mmio_host_reset_stats();
+    CHECK(aes_128_cbc_encrypt(key, sw_iv, engine_hw + 1, 0x1000) == 0);
+    CHECK(!memcmp(engine_hw + 1, engine_sw, 0x1000));
+
+    mmio_host_get_stats(&stats);
+    CHECK_EQ(stats.aes_commands, 0);
+
+    /* The engine is checked for on every call, so contexts set up while it was held off still get to use it afterwards */
+    aes_hw_hold();
+    aes_128_init(&ctx, key, sw_iv, true);
+    aes_hw_release();
+
+    memcpy(engine_hw, engine_src, 0x1000);
+    mmio_host_reset_stats();
+    CHECK(aes_128_cbc_encrypt_ctx(&ctx, engine_hw, 0x1000) == 0);
+    CHECK(!memcmp(engine_hw, engine_sw, 0x1000));
+    aes_128_deinit(&ctx);
+
+    mmio_host_get_stats(&stats);
+    CHECK_EQ(stats.aes_blocks, 0x1000 / AES_BLOCK_SIZE);
+
+    /* Misaligned buffers, partial blocks and held engines are refused without touching the registers */
+    mmio_host_reset_stats();
+    CHECK(!aes_hw_cbc(key, iv, engine_hw + 4, engine_hw + 4, 0x100, true, NULL));
+    CHECK(!aes_hw_cbc(key, iv, engine_hw, engine_hw, 0x108, true, NULL));
+
+    aes_hw_hold();
+    CHECK(!aes_hw_available());
+    CHECK(!aes_hw_cbc(key, iv, engine_hw, engine_hw, 0x100, true, NULL));
+    aes_hw_release();
+
+    mmio_host_get_stats(&stats);
+    CHECK_EQ(stats.reads + stats.writes, 0);
+
+    /* Engine errors are reported, and the IV isn't updated */
+    memcpy(sw_iv, iv, sizeof(iv));
+    mmio_host_fail_engines(true);
+    CHECK(!aes_hw_cbc(key, iv, engine_hw, engine_hw, 0x100, true, iv));
+    CHECK(!memcmp(iv, sw_iv, sizeof(iv)));
+    mmio_host_fail_engines(false);
+}
+
+static bool ShaHardwareMatchesSoftware(const u8 *data, u32 size, u32 split)
+{
+    mmio_host_stats_t stats = {0};
+    SHA1Context ctx = {0};
+    sha1 hw_hash = {0}, sw_hash = {0};
+
+    sha_hw_hold();
+    bool sw_ok = (SHA1((u8*)data, size, sw_hash) == shaSuccess);
+    sha_hw_release();
+    if (!sw_ok) return false;
+
+    /* Feed the data in two parts, so the second one starts with a partial block when the split isn't block-aligned */
+    mmio_host_reset_stats();
+    if (SHA1Reset(&ctx) != shaSuccess || SHA1Input(&ctx, (u8*)data, split) != shaSuccess || SHA1Input(&ctx, (u8*)data + split, size - split) != shaSuccess || \
+        SHA1Result(&ctx, hw_hash) != shaSuccess) return false;
+
+    mmio_host_get_stats(&stats);
+    if (stats.sha_blocks > (size / SHA_HW_BLOCK_SIZE)) return false;
+
+    return !memcmp(hw_hash, sw_hash, sizeof(sw_hash));
+}
+
+static void TestShaEngine(void)
+{
+    static const u32 state_iv[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+
+    mmio_host_stats_t stats = {0};
+    u32 hw_state[5] = {0}, sw_state[5] = {0};
+    SHA1Context ctx = {0};
+    sha1 hash = {0}, sw_hash = {0};
+
+    FillImage(engine_src, ENGINE_BUF_SIZE + SHA_HW_ALIGNMENT, 0x2B, 0x9C);
+
+    /* The driver's own known answer test has to pass through the simulated engine */
+    mmio_host_reset();
+    CHECK(sha_hw_available());
+
+    mmio_host_get_stats(&stats);
+    CHECK_EQ(stats.sha_commands, 1);
+
+    /* Whole blocks only: 0x480 blocks take two commands, and give the same hash as software */
+    mmio_host_reset_stats();
+    CHECK(ShaHardwareMatchesSoftware(engine_src, 0x480 * SHA_HW_BLOCK_SIZE, 0));
+
+    mmio_host_get_stats(&stats);
+    CHECK_EQ(stats.sha_commands, 2);
+    CHECK_EQ(stats.sha_blocks, 0x480);
+
+    /* Trailing partial block, input split within a block, minimum size and misaligned input */
+    CHECK(ShaHardwareMatchesSoftware(engine_src, ENGINE_BUF_SIZE + 37, 0));
+    CHECK(ShaHardwareMatchesSoftware(engine_src, ENGINE_BUF_SIZE, 0x1D));
+    CHECK(ShaHardwareMatchesSoftware(engine_src, ENGINE_BUF_SIZE, SHA_HW_ALIGNMENT));
+    CHECK(ShaHardwareMatchesSoftware(engine_src, SHA_HW_MIN_SIZE, 0));
+    CHECK(ShaHardwareMatchesSoftware(engine_src + 8, 0x4000, 0));
+
+    mmio_host_reset_stats();
+    CHECK(ShaHardwareMatchesSoftware(engine_src + 8, 0x4000, 0));
+    mmio_host_get_stats(&stats);
+    CHECK_EQ(stats.sha_commands, 0);
+
+    /* Short inputs stay in software */
+    mmio_host_reset_stats();
+    CHECK(SHA1(engine_src, SHA_HW_MIN_SIZE - SHA_HW_BLOCK_SIZE, hash) == shaSuccess);
+    mmio_host_get_stats(&stats);
+    CHECK_EQ(stats.sha_commands, 0);
+
+    /* SHA1Input() checks for the engine on every call, so a hash started while it was held off picks it up once it's released */
+    mmio_host_reset_stats();
+    CHECK(SHA1Reset(&ctx) == shaSuccess);
+    sha_hw_hold();
+    CHECK(SHA1Input(&ctx, engine_src, 0x4000) == shaSuccess);
+    sha_hw_release();
+    CHECK(SHA1Input(&ctx, engine_src + 0x4000, 0x4000) == shaSuccess);
+    CHECK(SHA1Result(&ctx, hash) == shaSuccess);
+
+    mmio_host_get_stats(&stats);
+    CHECK_EQ(stats.sha_blocks, 0x4000 / SHA_HW_BLOCK_SIZE);
+
+    CHECK(SHA1(engine_src, 0x8000, sw_hash) == shaSuccess);
+    CHECK(!memcmp(hash, sw_hash, sizeof(sw_hash)));
+
+    /* The hash state is left untouched on engine errors, and held engines are refused */
+    memcpy(hw_state, state_iv, sizeof(state_iv));
+    memcpy(sw_state, state_iv, sizeof(state_iv));
+    mmio_host_fail_engines(true);
+    CHECK(!sha_hw_process_blocks(hw_state, engine_src, 4));
+    CHECK(!memcmp(hw_state, sw_state, sizeof(sw_state)));
+    mmio_host_fail_engines(false);
+
+    sha_hw_hold();
+    CHECK(!sha_hw_available());
+    CHECK(!sha_hw_process_blocks(hw_state, engine_src, 4));
+    sha_hw_release();
+
+    CHECK(!sha_hw_process_blocks(hw_state, engine_src + 4, 4));
+    CHECK(!memcmp(hw_state, sw_state, sizeof(sw_state)));
+}
+
+int main(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+
+    LoadImages();
+    aes_hw_init();
+    sha_hw_init();
+
+    printf("Host MMIO tests:\n");
+
+    TestOtp();
+    TestSeepromRead();
+    TestSeepromWrite();
+    TestSeepromCalibrate();
+    TestBoot0(false);
+    TestBoot0(true);
+    TestSramOtp();
+    TestAesEngine();
+    TestShaEngine();
+
+    printf("\t- %s.\n", failures ? "FAILED" : "All checks passed");
+
+    return (failures ? EXIT_FAILURE : EXIT_SUCCESS);
+}
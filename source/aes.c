@@ -18,10 +18,13 @@
  * See README and COPYING for more details.
  */
 
-#include <stdlib.h>
 #include <string.h>
 #include <gctypes.h>
 
+#include "aes.h"
+#include "aes_internal.h"
+#include "aes_hw.h"
+
 static const u32 Te0[256] = {
     0xc66363a5U, 0xf87c7c84U, 0xee777799U, 0xf67b7b8dU,
     0xfff2f20dU, 0xd66b6bbdU, 0xde6f6fb1U, 0x91c5c554U,
@@ -89,6 +92,7 @@ static const u32 Te0[256] = {
     0x7bb0b0cbU, 0xa85454fcU, 0x6dbbbbd6U, 0x2c16163aU,
 };
 
+#ifndef AES_SMALL_TABLES
 static const u32 Te1[256] = {
     0xa5c66363U, 0x84f87c7cU, 0x99ee7777U, 0x8df67b7bU,
     0x0dfff2f2U, 0xbdd66b6bU, 0xb1de6f6fU, 0x5491c5c5U,
@@ -357,6 +361,8 @@ static const u32 Te4[256] = {
     0xb0b0b0b0U, 0x54545454U, 0xbbbbbbbbU, 0x16161616U,
 };
 
+#endif /* AES_SMALL_TABLES */
+
 static const u32 Td0[256] = {
     0x51f4a750U, 0x7e416553U, 0x1a17a4c3U, 0x3a275e96U,
     0x3bab6bcbU, 0x1f9d45f1U, 0xacfa58abU, 0x4be30393U,
@@ -424,6 +430,7 @@ static const u32 Td0[256] = {
     0x7bcb8461U, 0xd532b670U, 0x486c5c74U, 0xd0b85742U,
 };
 
+#ifndef AES_SMALL_TABLES
 static const u32 Td1[256] = {
     0x5051f4a7U, 0x537e4165U, 0xc31a17a4U, 0x963a275eU,
     0xcb3bab6bU, 0xf11f9d45U, 0xabacfa58U, 0x934be303U,
@@ -692,6 +699,45 @@ static const u32 Td4[256] = {
     0x55555555U, 0x21212121U, 0x0c0c0c0cU, 0x7d7d7d7dU,
 };
 
+#else  /* AES_SMALL_TABLES */
+
+static const u8 Td4s[256] = {
+    0x52, 0x09, 0x6a, 0xd5, 0x30, 0x36, 0xa5, 0x38,
+    0xbf, 0x40, 0xa3, 0x9e, 0x81, 0xf3, 0xd7, 0xfb,
+    0x7c, 0xe3, 0x39, 0x82, 0x9b, 0x2f, 0xff, 0x87,
+    0x34, 0x8e, 0x43, 0x44, 0xc4, 0xde, 0xe9, 0xcb,
+    0x54, 0x7b, 0x94, 0x32, 0xa6, 0xc2, 0x23, 0x3d,
+    0xee, 0x4c, 0x95, 0x0b, 0x42, 0xfa, 0xc3, 0x4e,
+    0x08, 0x2e, 0xa1, 0x66, 0x28, 0xd9, 0x24, 0xb2,
+    0x76, 0x5b, 0xa2, 0x49, 0x6d, 0x8b, 0xd1, 0x25,
+    0x72, 0xf8, 0xf6, 0x64, 0x86, 0x68, 0x98, 0x16,
+    0xd4, 0xa4, 0x5c, 0xcc, 0x5d, 0x65, 0xb6, 0x92,
+    0x6c, 0x70, 0x48, 0x50, 0xfd, 0xed, 0xb9, 0xda,
+    0x5e, 0x15, 0x46, 0x57, 0xa7, 0x8d, 0x9d, 0x84,
+    0x90, 0xd8, 0xab, 0x00, 0x8c, 0xbc, 0xd3, 0x0a,
+    0xf7, 0xe4, 0x58, 0x05, 0xb8, 0xb3, 0x45, 0x06,
+    0xd0, 0x2c, 0x1e, 0x8f, 0xca, 0x3f, 0x0f, 0x02,
+    0xc1, 0xaf, 0xbd, 0x03, 0x01, 0x13, 0x8a, 0x6b,
+    0x3a, 0x91, 0x11, 0x41, 0x4f, 0x67, 0xdc, 0xea,
+    0x97, 0xf2, 0xcf, 0xce, 0xf0, 0xb4, 0xe6, 0x73,
+    0x96, 0xac, 0x74, 0x22, 0xe7, 0xad, 0x35, 0x85,
+    0xe2, 0xf9, 0x37, 0xe8, 0x1c, 0x75, 0xdf, 0x6e,
+    0x47, 0xf1, 0x1a, 0x71, 0x1d, 0x29, 0xc5, 0x89,
+    0x6f, 0xb7, 0x62, 0x0e, 0xaa, 0x18, 0xbe, 0x1b,
+    0xfc, 0x56, 0x3e, 0x4b, 0xc6, 0xd2, 0x79, 0x20,
+    0x9a, 0xdb, 0xc0, 0xfe, 0x78, 0xcd, 0x5a, 0xf4,
+    0x1f, 0xdd, 0xa8, 0x33, 0x88, 0x07, 0xc7, 0x31,
+    0xb1, 0x12, 0x10, 0x59, 0x27, 0x80, 0xec, 0x5f,
+    0x60, 0x51, 0x7f, 0xa9, 0x19, 0xb5, 0x4a, 0x0d,
+    0x2d, 0xe5, 0x7a, 0x9f, 0x93, 0xc9, 0x9c, 0xef,
+    0xa0, 0xe0, 0x3b, 0x4d, 0xae, 0x2a, 0xf5, 0xb0,
+    0xc8, 0xeb, 0xbb, 0x3c, 0x83, 0x53, 0x99, 0x61,
+    0x17, 0x2b, 0x04, 0x7e, 0xba, 0x77, 0xd6, 0x26,
+    0xe1, 0x69, 0x14, 0x63, 0x55, 0x21, 0x0c, 0x7d,
+};
+
+#endif /* AES_SMALL_TABLES */
+
 static const u32 rcon[] = {
 	0x01000000, 0x02000000, 0x04000000, 0x08000000,
 	0x10000000, 0x20000000, 0x40000000, 0x80000000,
@@ -705,6 +751,8 @@ static const u32 rcon[] = {
 
 #define RCON(i) rcon[(i)]
 
+#ifndef AES_SMALL_TABLES
+
 #define TE0(i) Te0[((i) >> 24) & 0xff]
 #define TE1(i) Te1[((i) >> 16) & 0xff]
 #define TE2(i) Te2[((i) >> 8) & 0xff]
@@ -732,8 +780,41 @@ static const u32 rcon[] = {
 #define TD2_(i) Td2[(i) & 0xff]
 #define TD3_(i) Td3[(i) & 0xff]
 
-#define AES_BLOCK_SIZE 16
-#define AES_PRIV_SIZE (4 * 44)
+#else  /* AES_SMALL_TABLES */
+
+/* Te0 and Td0 hold every column of the round tables, rotated. Te0 also carries the S-box in its middle bytes, while */
+/* the inverse S-box gets its own byte-sized table */
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+#define TE0(i) Te0[((i) >> 24) & 0xff]
+#define TE1(i) ROTR(Te0[((i) >> 16) & 0xff], 8)
+#define TE2(i) ROTR(Te0[((i) >> 8) & 0xff], 16)
+#define TE3(i) ROTR(Te0[(i) & 0xff], 24)
+#define TE41(i) ((Te0[((i) >> 24) & 0xff] << 8) & 0xff000000)
+#define TE42(i) (Te0[((i) >> 16) & 0xff] & 0x00ff0000)
+#define TE43(i) (Te0[((i) >> 8) & 0xff] & 0x0000ff00)
+#define TE44(i) ((Te0[(i) & 0xff] >> 8) & 0x000000ff)
+#define TE421(i) ((Te0[((i) >> 16) & 0xff] << 8) & 0xff000000)
+#define TE432(i) (Te0[((i) >> 8) & 0xff] & 0x00ff0000)
+#define TE443(i) (Te0[(i) & 0xff] & 0x0000ff00)
+#define TE414(i) ((Te0[((i) >> 24) & 0xff] >> 8) & 0x000000ff)
+#define TE4(i) ((Te0[(i)] >> 8) & 0x000000ff)
+
+#define TD0(i) Td0[((i) >> 24) & 0xff]
+#define TD1(i) ROTR(Td0[((i) >> 16) & 0xff], 8)
+#define TD2(i) ROTR(Td0[((i) >> 8) & 0xff], 16)
+#define TD3(i) ROTR(Td0[(i) & 0xff], 24)
+#define TD41(i) ((u32)Td4s[((i) >> 24) & 0xff] << 24)
+#define TD42(i) ((u32)Td4s[((i) >> 16) & 0xff] << 16)
+#define TD43(i) ((u32)Td4s[((i) >> 8) & 0xff] << 8)
+#define TD44(i) ((u32)Td4s[(i) & 0xff])
+#define TD0_(i) Td0[(i) & 0xff]
+#define TD1_(i) ROTR(Td0[(i) & 0xff], 8)
+#define TD2_(i) ROTR(Td0[(i) & 0xff], 16)
+#define TD3_(i) ROTR(Td0[(i) & 0xff], 24)
+
+#endif /* AES_SMALL_TABLES */
+
 
 /*
  * Expand the cipher key into the encryption key schedule.
@@ -925,90 +1006,304 @@ d##3 = TD0(s##3) ^ TD1(s##2) ^ TD2(s##1) ^ TD3(s##0) ^ rk[4 * i + 3]
 	PUTU32(pt + 12, s3);
 }
 
-void *aes_init(const u8 *key, bool Enc)
+/*
+ * Decrypts two independent blocks in lockstep. Both cipher states are kept
+ * in registers at the same time, so the table lookups for one block can be
+ * issued while the ones for the other block are still in flight. Going past
+ * two blocks would run out of general purpose registers on Broadway.
+ */
+static void rijndaelDecrypt2(const u32 rk[/*44*/], const u8 ct[32], u8 pt[32])
 {
-	u32 *rk = malloc(AES_PRIV_SIZE);
-	if (rk == NULL) return NULL;
+	u32 s0, s1, s2, s3, t0, t1, t2, t3;
+	u32 u0, u1, u2, u3, v0, v1, v2, v3;
+	int r;
+
+	s0 = GETU32(ct     ) ^ rk[0];
+	s1 = GETU32(ct +  4) ^ rk[1];
+	s2 = GETU32(ct +  8) ^ rk[2];
+	s3 = GETU32(ct + 12) ^ rk[3];
+	u0 = GETU32(ct + 16) ^ rk[0];
+	u1 = GETU32(ct + 20) ^ rk[1];
+	u2 = GETU32(ct + 24) ^ rk[2];
+	u3 = GETU32(ct + 28) ^ rk[3];
 
-	if (Enc)
+#define ROUND2(i,d,s,e,u) \
+d##0 = TD0(s##0) ^ TD1(s##3) ^ TD2(s##2) ^ TD3(s##1) ^ rk[4 * i]; \
+e##0 = TD0(u##0) ^ TD1(u##3) ^ TD2(u##2) ^ TD3(u##1) ^ rk[4 * i]; \
+d##1 = TD0(s##1) ^ TD1(s##0) ^ TD2(s##3) ^ TD3(s##2) ^ rk[4 * i + 1]; \
+e##1 = TD0(u##1) ^ TD1(u##0) ^ TD2(u##3) ^ TD3(u##2) ^ rk[4 * i + 1]; \
+d##2 = TD0(s##2) ^ TD1(s##1) ^ TD2(s##0) ^ TD3(s##3) ^ rk[4 * i + 2]; \
+e##2 = TD0(u##2) ^ TD1(u##1) ^ TD2(u##0) ^ TD3(u##3) ^ rk[4 * i + 2]; \
+d##3 = TD0(s##3) ^ TD1(s##2) ^ TD2(s##1) ^ TD3(s##0) ^ rk[4 * i + 3]; \
+e##3 = TD0(u##3) ^ TD1(u##2) ^ TD2(u##1) ^ TD3(u##0) ^ rk[4 * i + 3]
+
+	/* Nr - 1 full rounds: */
+	r = 10 >> 1;
+	for (;;)
 	{
-		rijndaelKeySetupEnc(rk, key);
+		ROUND2(1,t,s,v,u);
+		rk += 8;
+		if (--r == 0) break;
+		ROUND2(0,s,t,u,v);
+	}
+
+#undef ROUND2
+
+	/*
+	 * apply last round and
+	 * map cipher states to byte array blocks:
+	 */
+	s0 = TD41(t0) ^ TD42(t3) ^ TD43(t2) ^ TD44(t1) ^ rk[0];
+	u0 = TD41(v0) ^ TD42(v3) ^ TD43(v2) ^ TD44(v1) ^ rk[0];
+	s1 = TD41(t1) ^ TD42(t0) ^ TD43(t3) ^ TD44(t2) ^ rk[1];
+	u1 = TD41(v1) ^ TD42(v0) ^ TD43(v3) ^ TD44(v2) ^ rk[1];
+	s2 = TD41(t2) ^ TD42(t1) ^ TD43(t0) ^ TD44(t3) ^ rk[2];
+	u2 = TD41(v2) ^ TD42(v1) ^ TD43(v0) ^ TD44(v3) ^ rk[2];
+	s3 = TD41(t3) ^ TD42(t2) ^ TD43(t1) ^ TD44(t0) ^ rk[3];
+	u3 = TD41(v3) ^ TD42(v2) ^ TD43(v1) ^ TD44(v0) ^ rk[3];
+
+	PUTU32(pt     , s0);
+	PUTU32(pt +  4, s1);
+	PUTU32(pt +  8, s2);
+	PUTU32(pt + 12, s3);
+	PUTU32(pt + 16, u0);
+	PUTU32(pt + 20, u1);
+	PUTU32(pt + 24, u2);
+	PUTU32(pt + 28, u3);
+}
+
+/*
+ * Tries to process the provided buffer using the hardware AES engine.
+ * Returns 1 on success, 0 if the software implementation should be used
+ * instead and -1 if the engine failed after clobbering the output buffer.
+ */
+static int aes_128_cbc_hw(const aes_ctx *ctx, const u8 *iv, const u8 *src, u8 *dst, size_t len, int enc, u8 *out_iv)
+{
+	if (!ctx->hw || !len || ((uintptr_t)src % AES_BLOCK_SIZE) || ((uintptr_t)dst % AES_BLOCK_SIZE) || !aes_hw_available()) return 0;
+
+	if (aes_hw_cbc(ctx->key, iv, src, dst, len, enc, out_iv)) return 1;
+
+	return (src == dst ? -1 : 0);
+}
+
+/**
+ * aes_128_init - Initialize an AES-128 CBC context
+ * @ctx: Context to initialize
+ * @key: Encryption/decryption key (16 bytes)
+ * @iv: CBC IV (16 bytes)
+ * @enc: Whether to expand the key schedule for encryption or decryption
+ *
+ * The key schedule is only expanded once, so the same context can be used to
+ * process as many chunks as needed. The CBC chaining value is carried over
+ * between calls to aes_128_cbc_encrypt_ctx() and aes_128_cbc_decrypt_ctx().
+ *
+ * The hardware AES engine is used for suitably aligned buffers if it's
+ * available at the time of each call, with the software implementation as a
+ * fallback. Set ctx->hw to false to keep the engine out of it entirely.
+ */
+void aes_128_init(aes_ctx *ctx, const u8 *key, const u8 *iv, bool enc)
+{
+	memcpy(ctx->key, key, AES_BLOCK_SIZE);
+	ctx->hw = true;
+
+	if (enc)
+	{
+		rijndaelKeySetupEnc(ctx->rk, key);
 	} else {
-		rijndaelKeySetupDec(rk, key);
+		rijndaelKeySetupDec(ctx->rk, key);
 	}
 
-	return rk;
+	aes_128_set_iv(ctx, iv);
 }
 
-void aes_deinit(void *ctx)
+/**
+ * aes_128_set_iv - Reset the CBC chaining value from an AES-128 CBC context
+ * @ctx: Initialized context
+ * @iv: CBC IV (16 bytes)
+ */
+void aes_128_set_iv(aes_ctx *ctx, const u8 *iv)
 {
-	memset(ctx, 0, AES_PRIV_SIZE);
-	free(ctx);
+	memcpy(ctx->cbc, iv, AES_BLOCK_SIZE);
 }
 
 /**
- * aes_128_cbc_encrypt - AES-128 CBC encryption
- * @key: Encryption key
- * @iv: Encryption IV for CBC mode (16 bytes)
+ * aes_128_deinit - Clear an AES-128 CBC context
+ * @ctx: Context to clear
+ */
+void aes_128_deinit(aes_ctx *ctx)
+{
+	memset(ctx, 0, sizeof(aes_ctx));
+}
+
+/**
+ * aes_128_cbc_encrypt_ctx - AES-128 CBC encryption using an existing context
+ * @ctx: Context initialized for encryption
  * @data: Data to encrypt in-place
  * @data_len: Length of data in bytes (must be divisible by 16)
  * Returns: 0 on success, -1 on failure
  */
-int aes_128_cbc_encrypt(const u8 *key, const u8 *iv, u8 *data, size_t data_len)
+int aes_128_cbc_encrypt_ctx(aes_ctx *ctx, u8 *data, size_t data_len)
 {
-	void *ctx;
-	u8 cbc[AES_BLOCK_SIZE];
 	u8 *pos = data;
-	int i, j, blocks;
+	int i, j, blocks, ret;
 
-	ctx = aes_init(key, true);
-	if (ctx == NULL) return -1;
+	blocks = data_len / AES_BLOCK_SIZE;
 
-	memcpy(cbc, iv, AES_BLOCK_SIZE);
+	ret = aes_128_cbc_hw(ctx, ctx->cbc, data, data, blocks * AES_BLOCK_SIZE, 1, ctx->cbc);
+	if (ret != 0) return (ret > 0 ? 0 : -1);
 
-	blocks = data_len / AES_BLOCK_SIZE;
 	for (i = 0; i < blocks; i++)
 	{
-		for (j = 0; j < AES_BLOCK_SIZE; j++) cbc[j] ^= pos[j];
-		rijndaelEncrypt(ctx, cbc, cbc);
-		memcpy(pos, cbc, AES_BLOCK_SIZE);
+		for (j = 0; j < AES_BLOCK_SIZE; j++) ctx->cbc[j] ^= pos[j];
+		rijndaelEncrypt(ctx->rk, ctx->cbc, ctx->cbc);
+		memcpy(pos, ctx->cbc, AES_BLOCK_SIZE);
 		pos += AES_BLOCK_SIZE;
 	}
 
-	aes_deinit(ctx);
 	return 0;
 }
 
 /**
- * aes_128_cbc_decrypt - AES-128 CBC decryption
- * @key: Decryption key
- * @iv: Decryption IV for CBC mode (16 bytes)
+ * aes_128_cbc_decrypt_ctx - AES-128 CBC decryption using an existing context
+ * @ctx: Context initialized for decryption
  * @data: Data to decrypt in-place
  * @data_len: Length of data in bytes (must be divisible by 16)
  * Returns: 0 on success, -1 on failure
  */
-int aes_128_cbc_decrypt(const u8 *key, const u8 *iv, u8 *data, size_t data_len)
+int aes_128_cbc_decrypt_ctx(aes_ctx *ctx, u8 *data, size_t data_len)
 {
-	void *ctx;
-	u8 cbc[AES_BLOCK_SIZE], tmp[AES_BLOCK_SIZE];
-	u8 *pos = data;
-	int i, j, blocks;
+	u8 next_cbc[AES_BLOCK_SIZE];
+	size_t len = (data_len - (data_len % AES_BLOCK_SIZE));
 
-	ctx = aes_init(key, false);
-	if (ctx == NULL) return -1;
+	if (!len) return 0;
 
-	memcpy(cbc, iv, AES_BLOCK_SIZE);
+	/* The last ciphertext block chains into the next call */
+	memcpy(next_cbc, data + len - AES_BLOCK_SIZE, AES_BLOCK_SIZE);
 
-	blocks = data_len / AES_BLOCK_SIZE;
-	for (i = 0; i < blocks; i++)
+	if (aes_128_cbc_decrypt_range_ctx(ctx, ctx->cbc, data, data, 0, len) != 0) return -1;
+
+	memcpy(ctx->cbc, next_cbc, AES_BLOCK_SIZE);
+
+	return 0;
+}
+
+/**
+ * aes_128_cbc_decrypt_range_ctx - AES-128 CBC decryption of a block-aligned range
+ * @ctx: Context initialized for decryption. Its CBC chaining value is ignored
+ * @iv: Chaining value for the first block from @data (16 bytes). Either the
+ * CBC IV or the ciphertext block that precedes @data within the stream
+ * @data: Encrypted data holding the requested range
+ * @out: Output buffer for the decrypted range. Can point to the range itself
+ * @offset: Offset to the range within @data (must be divisible by 16)
+ * @len: Length of the range in bytes (must be divisible by 16)
+ * Returns: 0 on success, -1 on failure
+ *
+ * Decrypting a CBC block only needs the ciphertext block right before it, so
+ * ranges can be decrypted in any order as long as @data isn't modified.
+ */
+int aes_128_cbc_decrypt_range_ctx(const aes_ctx *ctx, const u8 *iv, const u8 *data, u8 *out, size_t offset, size_t len)
+{
+	u8 cbc[AES_BLOCK_SIZE], tmp[AES_BLOCK_SIZE * 2];
+	const u8 *pos = (data + offset);
+	int i, j, blocks, ret;
+
+	if (offset % AES_BLOCK_SIZE) return -1;
+
+	memcpy(cbc, offset ? (pos - AES_BLOCK_SIZE) : iv, AES_BLOCK_SIZE);
+
+	blocks = len / AES_BLOCK_SIZE;
+
+	ret = aes_128_cbc_hw(ctx, cbc, pos, out, blocks * AES_BLOCK_SIZE, 0, NULL);
+	if (ret != 0) return (ret > 0 ? 0 : -1);
+
+	/* Every block only depends on its own ciphertext and the previous one, so we can decrypt them in pairs */
+	for (i = 0; (i + 1) < blocks; i += 2)
+	{
+		memcpy(tmp, pos, AES_BLOCK_SIZE * 2);
+		rijndaelDecrypt2(ctx->rk, tmp, out);
+		for (j = 0; j < AES_BLOCK_SIZE; j++)
+		{
+			out[j] ^= cbc[j];
+			out[AES_BLOCK_SIZE + j] ^= tmp[j];
+		}
+		memcpy(cbc, tmp + AES_BLOCK_SIZE, AES_BLOCK_SIZE);
+		pos += (AES_BLOCK_SIZE * 2);
+		out += (AES_BLOCK_SIZE * 2);
+	}
+
+	for (; i < blocks; i++)
 	{
 		memcpy(tmp, pos, AES_BLOCK_SIZE);
-		rijndaelDecrypt(ctx, pos, pos);
-		for (j = 0; j < AES_BLOCK_SIZE; j++) pos[j] ^= cbc[j];
+		rijndaelDecrypt(ctx->rk, tmp, out);
+		for (j = 0; j < AES_BLOCK_SIZE; j++) out[j] ^= cbc[j];
 		memcpy(cbc, tmp, AES_BLOCK_SIZE);
 		pos += AES_BLOCK_SIZE;
+		out += AES_BLOCK_SIZE;
 	}
 
-	aes_deinit(ctx);
 	return 0;
 }
+
+/**
+ * aes_128_cbc_encrypt - AES-128 CBC encryption
+ * @key: Encryption key
+ * @iv: Encryption IV for CBC mode (16 bytes)
+ * @data: Data to encrypt in-place
+ * @data_len: Length of data in bytes (must be divisible by 16)
+ * Returns: 0 on success, -1 on failure
+ */
+int aes_128_cbc_encrypt(const u8 *key, const u8 *iv, u8 *data, size_t data_len)
+{
+	aes_ctx ctx;
+	int ret;
+
+	aes_128_init(&ctx, key, iv, true);
+	ret = aes_128_cbc_encrypt_ctx(&ctx, data, data_len);
+	aes_128_deinit(&ctx);
+
+	return ret;
+}
+
+/**
+ * aes_128_cbc_decrypt - AES-128 CBC decryption
+ * @key: Decryption key
+ * @iv: Decryption IV for CBC mode (16 bytes)
+ * @data: Data to decrypt in-place
+ * @data_len: Length of data in bytes (must be divisible by 16)
+ * Returns: 0 on success, -1 on failure
+ */
+int aes_128_cbc_decrypt(const u8 *key, const u8 *iv, u8 *data, size_t data_len)
+{
+	aes_ctx ctx;
+	int ret;
+
+	aes_128_init(&ctx, key, iv, false);
+	ret = aes_128_cbc_decrypt_ctx(&ctx, data, data_len);
+	aes_128_deinit(&ctx);
+
+	return ret;
+}
+
+/**
+ * aes_128_cbc_decrypt_range - AES-128 CBC decryption of a block-aligned range
+ * @key: Decryption key
+ * @iv: Chaining value for the first block from @data (16 bytes)
+ * @data: Encrypted data holding the requested range
+ * @out: Output buffer for the decrypted range. Can point to the range itself
+ * @offset: Offset to the range within @data (must be divisible by 16)
+ * @len: Length of the range in bytes (must be divisible by 16)
+ * Returns: 0 on success, -1 on failure
+ *
+ * See aes_128_cbc_decrypt_range_ctx().
+ */
+int aes_128_cbc_decrypt_range(const u8 *key, const u8 *iv, const u8 *data, u8 *out, size_t offset, size_t len)
+{
+	aes_ctx ctx;
+	int ret;
+
+	aes_128_init(&ctx, key, iv, false);
+	ret = aes_128_cbc_decrypt_range_ctx(&ctx, iv, data, out, offset, len);
+	aes_128_deinit(&ctx);
+
+	return ret;
+}
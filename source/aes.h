@@ -21,7 +21,29 @@
 #ifndef __AES_H__
 #define __AES_H__
 
+#include <stddef.h>
+#include <gctypes.h>
+
+#define AES_BLOCK_SIZE 16
+#define AES_128_ROUND_KEYS 44
+
+typedef struct {
+	u32 rk[AES_128_ROUND_KEYS];	// Expanded key schedule.
+	u8 cbc[AES_BLOCK_SIZE];		// CBC chaining value carried over between calls.
+	u8 key[AES_BLOCK_SIZE];		// Raw key, needed by the hardware AES engine.
+	bool hw;			// Use the hardware AES engine whenever it's available. Set by aes_128_init().
+} aes_ctx;
+
+void aes_128_init(aes_ctx *ctx, const u8 *key, const u8 *iv, bool enc);
+void aes_128_set_iv(aes_ctx *ctx, const u8 *iv);
+void aes_128_deinit(aes_ctx *ctx);
+
+int aes_128_cbc_encrypt_ctx(aes_ctx *ctx, u8 *data, size_t data_len);
+int aes_128_cbc_decrypt_ctx(aes_ctx *ctx, u8 *data, size_t data_len);
+int aes_128_cbc_decrypt_range_ctx(const aes_ctx *ctx, const u8 *iv, const u8 *data, u8 *out, size_t offset, size_t len);
+
 int aes_128_cbc_encrypt(const u8 *key, const u8 *iv, u8 *data, size_t data_len);
 int aes_128_cbc_decrypt(const u8 *key, const u8 *iv, u8 *data, size_t data_len);
+int aes_128_cbc_decrypt_range(const u8 *key, const u8 *iv, const u8 *data, u8 *out, size_t offset, size_t len);
 
 #endif /* __AES_H__ */
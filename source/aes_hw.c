@@ -0,0 +1,186 @@
+#include <gccore.h>
+#include <string.h>
+
+#include "aes_hw.h"
+#include "tools.h"
+#include "mmio.h"
+
+#define HW_AES_REG_BASE     0xD020000
+#define HW_AES_CTRL         (HW_AES_REG_BASE + 0x00)
+#define HW_AES_SRC          (HW_AES_REG_BASE + 0x04)
+#define HW_AES_DEST         (HW_AES_REG_BASE + 0x08)
+#define HW_AES_KEY          (HW_AES_REG_BASE + 0x0C)
+#define HW_AES_IV           (HW_AES_REG_BASE + 0x10)
+
+#define AES_CTRL_EXEC       0x80000000
+#define AES_CTRL_ERR        0x20000000
+#define AES_CTRL_ENA        0x10000000
+#define AES_CTRL_DEC        0x08000000
+#define AES_CTRL_CHAIN      0x00001000  // Keep using the IV left over by the previous command.
+
+#define AES_HW_BLK_SIZE     16
+#define AES_HW_MAX_BLOCKS   0x80        // Same DMA transfer size used by MINI.
+
+#define AES_HW_TIMEOUT      0x1000000
+
+/* NIST SP 800-38A, F.2.1 (CBC-AES128.Encrypt), first two blocks */
+static const u8 aes_hw_kat_key[AES_HW_BLK_SIZE] = { 0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6, 0xAB, 0xF7, 0x15, 0x88, 0x09, 0xCF, 0x4F, 0x3C };
+static const u8 aes_hw_kat_iv[AES_HW_BLK_SIZE]  = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F };
+
+static const u8 aes_hw_kat_pt[AES_HW_BLK_SIZE * 2] = {
+    0x6B, 0xC1, 0xBE, 0xE2, 0x2E, 0x40, 0x9F, 0x96, 0xE9, 0x3D, 0x7E, 0x11, 0x73, 0x93, 0x17, 0x2A,
+    0xAE, 0x2D, 0x8A, 0x57, 0x1E, 0x03, 0xAC, 0x9C, 0x9E, 0xB7, 0x6F, 0xAC, 0x45, 0xAF, 0x8E, 0x51
+};
+
+static const u8 aes_hw_kat_ct[AES_HW_BLK_SIZE * 2] = {
+    0x76, 0x49, 0xAB, 0xAC, 0x81, 0x19, 0xB2, 0x46, 0xCE, 0xE9, 0x8E, 0x9B, 0x12, 0xE9, 0x19, 0x7D,
+    0x50, 0x86, 0xCB, 0x9B, 0x50, 0x72, 0x19, 0xEE, 0x95, 0xDB, 0x11, 0x3A, 0x91, 0x76, 0x78, 0xB2
+};
+
+static bool aes_hw_checked = false, aes_hw_ok = false;
+static volatile u32 aes_hw_hold_count = 0;
+
+/* Taken by holds and engine commands alike, so a hold waits for the command that's currently running, if any */
+static mutex_t aes_hw_mutex = LWP_MUTEX_NULL;
+
+static bool aes_hw_reset(void)
+{
+    mmio_write32(HW_AES_CTRL, 0);
+
+    for(u32 i = 0; i < AES_HW_TIMEOUT; i++)
+    {
+        if (!mmio_read32(HW_AES_CTRL)) return true;
+    }
+
+    return false;
+}
+
+static void aes_hw_write_fifo(u32 reg, const u8 *data)
+{
+    /* The engine expects big endian words */
+    for(u32 i = 0; i < AES_HW_BLK_SIZE; i += 4) mmio_write32(reg, ((u32)data[i] << 24) | ((u32)data[i + 1] << 16) | ((u32)data[i + 2] << 8) | data[i + 3]);
+}
+
+static bool aes_hw_run_cbc(const u8 *key, const u8 *iv, const u8 *src, u8 *dst, u32 size, bool enc, u8 *out_iv)
+{
+    if (aes_hw_hold_count || !key || !iv || !src || !dst || !size || !IS_ALIGNED(size, AES_HW_BLK_SIZE) || !IS_ALIGNED((uintptr_t)src, AES_HW_BLK_SIZE) || \
+        !IS_ALIGNED((uintptr_t)dst, AES_HW_BLK_SIZE)) return false;
+
+    u8 next_iv[AES_HW_BLK_SIZE] = {0};
+    u32 blocks = (size / AES_HW_BLK_SIZE), ctrl = 0;
+    bool success = false;
+
+    /* The last ciphertext block might get overwritten if we're decrypting in place */
+    if (!enc) memcpy(next_iv, src + size - AES_HW_BLK_SIZE, AES_HW_BLK_SIZE);
+
+    /* Write back any cached input data, as well as any dirty cache lines that partially overlap with the output buffer */
+    DCFlushRange((void*)src, size);
+    if (dst != src) DCFlushRange(dst, size);
+
+    /* Someone else (i.e. IOS) may have been using the engine, so reload everything */
+    if (!aes_hw_reset()) goto out;
+
+    aes_hw_write_fifo(HW_AES_KEY, key);
+    aes_hw_write_fifo(HW_AES_IV, iv);
+
+    for(u32 offset = 0; blocks > 0;)
+    {
+        u32 cur_blocks = (blocks > AES_HW_MAX_BLOCKS ? AES_HW_MAX_BLOCKS : blocks);
+
+        mmio_write32(HW_AES_SRC, mmio_dma_address(src + offset));
+        mmio_write32(HW_AES_DEST, mmio_dma_address(dst + offset));
+
+        mmio_write32(HW_AES_CTRL, AES_CTRL_EXEC | AES_CTRL_ENA | (enc ? 0 : AES_CTRL_DEC) | (offset ? AES_CTRL_CHAIN : 0) | (cur_blocks - 1));
+
+        u32 timeout = AES_HW_TIMEOUT;
+        while(((ctrl = mmio_read32(HW_AES_CTRL)) & AES_CTRL_EXEC) && --timeout);
+
+        if (!timeout || (ctrl & AES_CTRL_ERR)) goto out;
+
+        offset += (cur_blocks * AES_HW_BLK_SIZE);
+        blocks -= cur_blocks;
+    }
+
+    success = true;
+
+out:
+    /* Drop any stale cache lines from the output buffer, so the DMA'd data is visible */
+    DCInvalidateRange(dst, size);
+
+    if (!success) aes_hw_reset();
+
+    if (success && out_iv) memcpy(out_iv, enc ? (dst + size - AES_HW_BLK_SIZE) : next_iv, AES_HW_BLK_SIZE);
+
+    return success;
+}
+
+void aes_hw_init(void)
+{
+    LWP_MutexInit(&aes_hw_mutex, false);
+}
+
+bool aes_hw_cbc(const u8 *key, const u8 *iv, const u8 *src, u8 *dst, u32 size, bool enc, u8 *out_iv)
+{
+    LWP_MutexLock(aes_hw_mutex);
+    bool ret = aes_hw_run_cbc(key, iv, src, dst, size, enc, out_iv);
+    LWP_MutexUnlock(aes_hw_mutex);
+
+    return ret;
+}
+
+void aes_hw_hold(void)
+{
+    LWP_MutexLock(aes_hw_mutex);
+    aes_hw_hold_count++;
+    LWP_MutexUnlock(aes_hw_mutex);
+}
+
+void aes_hw_release(void)
+{
+    LWP_MutexLock(aes_hw_mutex);
+    if (aes_hw_hold_count) aes_hw_hold_count--;
+    LWP_MutexUnlock(aes_hw_mutex);
+}
+
+bool aes_hw_held(void)
+{
+    return (aes_hw_hold_count > 0);
+}
+
+static bool aes_hw_self_test(void)
+{
+    u8 ATTRIBUTE_ALIGN(32) buf[AES_HW_BLK_SIZE * 2] = {0};
+
+    if (!AHBPROT_DISABLED) return false;
+
+    /* Make sure the engine gives the expected results in both directions before trusting it with anything else */
+    memcpy(buf, aes_hw_kat_pt, sizeof(buf));
+    if (!aes_hw_run_cbc(aes_hw_kat_key, aes_hw_kat_iv, buf, buf, sizeof(buf), true, NULL) || memcmp(buf, aes_hw_kat_ct, sizeof(buf)) != 0) return false;
+
+    if (!aes_hw_run_cbc(aes_hw_kat_key, aes_hw_kat_iv, buf, buf, sizeof(buf), false, NULL) || memcmp(buf, aes_hw_kat_pt, sizeof(buf)) != 0) return false;
+
+    return true;
+}
+
+bool aes_hw_available(void)
+{
+    bool ret = false;
+
+    LWP_MutexLock(aes_hw_mutex);
+
+    /* Don't let the known answer test give a verdict we'd stick to while IOS may be using the engine */
+    if (!aes_hw_hold_count)
+    {
+        if (!aes_hw_checked)
+        {
+            aes_hw_ok = aes_hw_self_test();
+            aes_hw_checked = true;
+        }
+
+        ret = aes_hw_ok;
+    }
+
+    LWP_MutexUnlock(aes_hw_mutex);
+
+    return ret;
+}
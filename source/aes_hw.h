@@ -0,0 +1,30 @@
+#ifndef __AES_HW_H__
+#define __AES_HW_H__
+
+#include <gctypes.h>
+
+/* The Hollywood/Latte AES engine can only be driven from the PPC while HW_AHBPROT is disabled. It is shared with IOS, which uses it for NAND */
+/* and content decryption, so it must only be used while no IOS requests are in flight. Key and IV are reloaded on every call for that reason. */
+
+/* Sets up the lock that serializes holds and engine commands. Must be called once, before any other function from this file. */
+void aes_hw_init(void);
+
+/* IOS drives the engine while servicing NAND requests, so anyone with IOS requests in flight must hold it off for that long. */
+/* Callers fall back to software while it's held. Holds nest, so every aes_hw_hold() call must be paired with a aes_hw_release() call. */
+/* aes_hw_hold() waits for any engine command that's currently running, so the engine is idle by the time it returns. */
+void aes_hw_hold(void);
+void aes_hw_release(void);
+
+/* Returns true if the engine is currently being held off. */
+bool aes_hw_held(void);
+
+/* Returns true if the AES engine can be used. Runs a known answer test the first time it's called, and sticks to its result afterwards. */
+/* Returns false without running the test while the engine is held off, so callers should check it right before every use. */
+bool aes_hw_available(void);
+
+/* Runs AES-128-CBC over the provided data using the AES engine. Both buffers must be aligned to a 16-byte boundary, and the size must be a */
+/* multiple of 16. Buffers may overlap only if they're identical. The last output block (encryption) or input block (decryption) is written to */
+/* out_iv if it isn't NULL, so it can be used to chain the next call. Returns false if the engine reports an error. */
+bool aes_hw_cbc(const u8 *key, const u8 *iv, const u8 *src, u8 *dst, u32 size, bool enc, u8 *out_iv);
+
+#endif /* __AES_HW_H__ */
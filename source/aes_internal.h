@@ -0,0 +1,13 @@
+#ifndef __AES_INTERNAL_H__
+#define __AES_INTERNAL_H__
+
+#include <gctypes.h>
+
+/* Raw AES-128 block cipher primitives from aes.c. Only meant for code that needs single blocks without CBC chaining, like the benchmark */
+/* and the simulated AES engine. Everything else should stick to the aes_128_*() interface from aes.h. */
+void rijndaelKeySetupEnc(u32 rk[/*44*/], const u8 cipherKey[]);
+void rijndaelKeySetupDec(u32 rk[/*44*/], const u8 cipherKey[]);
+void rijndaelEncrypt(const u32 rk[/*44*/], const u8 pt[16], u8 ct[16]);
+void rijndaelDecrypt(const u32 rk[/*44*/], const u8 ct[16], u8 pt[16]);
+
+#endif /* __AES_INTERNAL_H__ */
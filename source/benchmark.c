@@ -0,0 +1,318 @@
+#ifdef XYZZY_BENCHMARK
+
+#include <stdlib.h>
+#include <string.h>
+#include <gccore.h>
+#include <ogc/lwp_watchdog.h>
+
+#include "tools.h"
+#include "benchmark.h"
+#include "cryptobench.h"
+#include "keyscan.h"
+#include "xxhash.h"
+#include "aes.h"
+#include "aes_internal.h"
+#include "aes_hw.h"
+#include "sha_hw.h"
+
+#define BENCHMARK_MIB       0x100000
+#define BENCHMARK_BUF_SIZE  (4 * BENCHMARK_MIB)
+
+/* Same chunk size used to process the vWii System Menu ancast image body */
+#define BENCHMARK_AES_CHUNK_SIZE    0x10000
+
+static u32 prng_state = 0x5EED1234;
+
+static u32 GetPseudoRandomWord(void)
+{
+    /* xorshift32 */
+    prng_state ^= (prng_state << 13);
+    prng_state ^= (prng_state >> 17);
+    prng_state ^= (prng_state << 5);
+    return prng_state;
+}
+
+static void FillBufferWithPseudoRandomData(u8 *buf, u32 size)
+{
+    for(u32 i = 0; i < size; i += 4)
+    {
+        u32 val = GetPseudoRandomWord();
+        memcpy(buf + i, &val, (size - i) < 4 ? (size - i) : 4);
+    }
+}
+
+static void PrintTimePerMiB(const char *name, u32 size, u64 elapsed_us)
+{
+    printf("\t- %-28s %7u us/MiB.\n", name, (u32)((elapsed_us * BENCHMARK_MIB) / size));
+}
+
+static void PrintThroughput(const char *name, u32 size, u64 elapsed_us)
+{
+    /* Hundredths of a MiB per second */
+    u32 rate = (elapsed_us ? (u32)(((u64)size * 100 * 1000000) / (elapsed_us * BENCHMARK_MIB)) : 0);
+    printf("\t- %-28s %4u.%02u MiB/s.\n", name, rate / 100, rate % 100);
+}
+
+static u32 LegacyScanBufferForKey(const u8 *buf, u32 size, additional_keyinfo_t *key)
+{
+    sha1 hash = {0};
+
+    /* Reference implementation: XXH32 at every single offset, without any prefiltering */
+    for(u32 offset = 0; (offset + key->key_size) <= size; offset += KEYSCAN_STRIDE)
+    {
+        if (XXH32(buf + offset, key->key_size, 0) != key->xxhash || SHA1((u8*)(buf + offset), key->key_size, hash) != shaSuccess || \
+            memcmp(hash, key->hash, SHA1HashSize) != 0) continue;
+
+        memcpy(key->key, buf + offset, key->key_size);
+        key->retrieved = true;
+        return 1;
+    }
+
+    return 0;
+}
+
+static void BenchmarkKeyScanner(const u8 *buf, u32 size)
+{
+    u64 start = 0;
+    u8 probe[16] = {0};
+    additional_keyinfo_t key = {0}, *keys[] = { &key };
+
+    /* Build a descriptor for a pseudorandom key that isn't part of our buffer, so both scanners need to sweep all of it */
+    FillBufferWithPseudoRandomData(probe, sizeof(probe));
+    key.key_size = sizeof(probe);
+    key.xxhash = XXH32(probe, sizeof(probe), 0);
+    SHA1(probe, sizeof(probe), key.hash);
+    key.prefilter = CalculateKeyPrefilterResidue(probe);
+
+    printf("Key scanner (%u MiB buffer):\n", size / BENCHMARK_MIB);
+
+    start = gettime();
+    LegacyScanBufferForKey(buf, size, &key);
+    PrintTimePerMiB("XXH32 at every offset:", size, diff_usec(start, gettime()));
+
+    key.retrieved = false;
+
+    start = gettime();
+    ScanBufferForKeys(buf, size, keys, MAX_ELEMENTS(keys));
+    PrintTimePerMiB("Prefilter + XXH32:", size, diff_usec(start, gettime()));
+
+    printf("\n");
+}
+
+static void LegacyDecryptChunk(aes_ctx *ctx, u8 *data, u32 size)
+{
+    u8 tmp[AES_BLOCK_SIZE] = {0};
+
+    /* Reference implementation: one block at a time */
+    for(u32 offset = 0; (offset + AES_BLOCK_SIZE) <= size; offset += AES_BLOCK_SIZE)
+    {
+        memcpy(tmp, data + offset, AES_BLOCK_SIZE);
+        rijndaelDecrypt(ctx->rk, tmp, data + offset);
+        for(u32 i = 0; i < AES_BLOCK_SIZE; i++) data[offset + i] ^= ctx->cbc[i];
+        memcpy(ctx->cbc, tmp, AES_BLOCK_SIZE);
+    }
+}
+
+static void BenchmarkAESDecryption(u8 *buf, u32 size)
+{
+    u64 start = 0;
+    u8 key[AES_BLOCK_SIZE] = {0}, iv[AES_BLOCK_SIZE] = {0};
+    aes_ctx ctx = {0};
+
+    FillBufferWithPseudoRandomData(key, sizeof(key));
+    FillBufferWithPseudoRandomData(iv, sizeof(iv));
+
+    printf("AES-128-CBC decryption (%u MiB, %u KiB chunks):\n", size / BENCHMARK_MIB, BENCHMARK_AES_CHUNK_SIZE / 1024);
+
+    /* Both runs decrypt the buffer in place, chunk by chunk, carrying the CBC state over like the ancast image body reader does */
+    /* The data is garbage after the first run, but that doesn't matter for timing purposes */
+    aes_128_init(&ctx, key, iv, false);
+
+    start = gettime();
+    for(u32 offset = 0; offset < size; offset += BENCHMARK_AES_CHUNK_SIZE) LegacyDecryptChunk(&ctx, buf + offset, BENCHMARK_AES_CHUNK_SIZE);
+    PrintThroughput("One block at a time:", size, diff_usec(start, gettime()));
+
+    /* Keep the hardware AES engine out of the software runs */
+    bool hw = aes_hw_available();
+    ctx.hw = false;
+
+    aes_128_set_iv(&ctx, iv);
+
+    start = gettime();
+    for(u32 offset = 0; offset < size; offset += BENCHMARK_AES_CHUNK_SIZE) aes_128_cbc_decrypt_ctx(&ctx, buf + offset, BENCHMARK_AES_CHUNK_SIZE);
+    PrintThroughput("Interleaved block pairs:", size, diff_usec(start, gettime()));
+
+    if (hw)
+    {
+        ctx.hw = true;
+        aes_128_set_iv(&ctx, iv);
+
+        start = gettime();
+        for(u32 offset = 0; offset < size; offset += BENCHMARK_AES_CHUNK_SIZE) aes_128_cbc_decrypt_ctx(&ctx, buf + offset, BENCHMARK_AES_CHUNK_SIZE);
+        PrintThroughput("Hardware AES engine:", size, diff_usec(start, gettime()));
+    } else {
+        printf("Hardware AES engine unavailable.\n");
+    }
+
+    aes_128_deinit(&ctx);
+
+    printf("\n");
+}
+
+static void BenchmarkAncastWorkload(const u8 *buf, u32 size)
+{
+    u64 start = 0;
+    u8 key[AES_BLOCK_SIZE] = {0}, iv[AES_BLOCK_SIZE] = {0}, probe[16] = {0};
+    additional_keyinfo_t probe_key = {0}, *keys[] = { &probe_key };
+    aes_ctx ctx = {0};
+    SHA1Context sha1_ctx = {0};
+    sha1 hash = {0};
+
+    /* Plaintext chunks go to a separate buffer, with the scanner carry area right before it */
+    u8 *plain_buf = memalign(32, KEYSCAN_CARRY_SIZE + BENCHMARK_AES_CHUNK_SIZE);
+    if (!plain_buf)
+    {
+        printf("Error allocating memory for plaintext buffer.\n\n");
+        return;
+    }
+
+    u8 *plain = (plain_buf + KEYSCAN_CARRY_SIZE);
+    keyscan_stream_t stream = {0};
+
+    FillBufferWithPseudoRandomData(key, sizeof(key));
+    FillBufferWithPseudoRandomData(iv, sizeof(iv));
+
+    /* Same missing key trick as the key scanner benchmark, so every chunk gets fully scanned */
+    FillBufferWithPseudoRandomData(probe, sizeof(probe));
+    probe_key.key_size = sizeof(probe);
+    probe_key.xxhash = XXH32(probe, sizeof(probe), 0);
+    SHA1(probe, sizeof(probe), probe_key.hash);
+    probe_key.prefilter = CalculateKeyPrefilterResidue(probe);
+
+#ifdef AES_SMALL_TABLES
+    printf("Ancast body workload, compact AES tables (%u MiB):\n", size / BENCHMARK_MIB);
+#else
+    printf("Ancast body workload, full AES tables (%u MiB):\n", size / BENCHMARK_MIB);
+#endif
+
+    /* Hash, decrypt and scan each chunk like ProcessAncastImageBody() does, so the AES tables compete with the scan buffers for */
+    /* the data cache. The hardware AES engine is kept out of this, since it's the software tables we're measuring */
+    aes_128_init(&ctx, key, iv, false);
+    ctx.hw = false;
+
+    SHA1Reset(&sha1_ctx);
+    memcpy(ctx.cbc, iv, AES_BLOCK_SIZE);
+
+    start = gettime();
+
+    for(u32 offset = 0; offset < size; offset += BENCHMARK_AES_CHUNK_SIZE)
+    {
+        SHA1Input(&sha1_ctx, (u8*)(buf + offset), BENCHMARK_AES_CHUNK_SIZE);
+        aes_128_cbc_decrypt_range_ctx(&ctx, ctx.cbc, buf + offset, plain, 0, BENCHMARK_AES_CHUNK_SIZE);
+        memcpy(ctx.cbc, buf + offset + BENCHMARK_AES_CHUNK_SIZE - AES_BLOCK_SIZE, AES_BLOCK_SIZE);
+        ScanStreamChunkForKeys(&stream, plain, BENCHMARK_AES_CHUNK_SIZE, keys, MAX_ELEMENTS(keys));
+    }
+
+    SHA1Result(&sha1_ctx, hash);
+
+    PrintThroughput("Hash + decrypt + scan:", size, diff_usec(start, gettime()));
+
+    aes_128_deinit(&ctx);
+    free(plain_buf);
+
+    printf("\n");
+}
+
+static void HashBufferInChunks(u8 *buf, u32 size, sha1 hash)
+{
+    SHA1Context ctx = {0};
+
+    SHA1Reset(&ctx);
+    for(u32 offset = 0; offset < size; offset += BENCHMARK_AES_CHUNK_SIZE) SHA1Input(&ctx, buf + offset, BENCHMARK_AES_CHUNK_SIZE);
+    SHA1Result(&ctx, hash);
+}
+
+static void BenchmarkSHA1(u8 *buf, u32 size)
+{
+    u64 start = 0;
+    sha1 hash = {0};
+
+    /* Hashing a buffer in SYSMENU_CHUNK_SIZE-sized pieces, like the ancast image body reader does */
+    printf("SHA-1 (%u MiB, %u KiB chunks):\n", size / BENCHMARK_MIB, BENCHMARK_AES_CHUNK_SIZE / 1024);
+
+    /* A misaligned pointer keeps the hardware SHA engine out of this run */
+    start = gettime();
+    HashBufferInChunks(buf + 1, size - BENCHMARK_AES_CHUNK_SIZE, hash);
+    PrintThroughput("Software:", size - BENCHMARK_AES_CHUNK_SIZE, diff_usec(start, gettime()));
+
+    if (sha_hw_available())
+    {
+        start = gettime();
+        HashBufferInChunks(buf, size - BENCHMARK_AES_CHUNK_SIZE, hash);
+        PrintThroughput("Hardware SHA engine:", size - BENCHMARK_AES_CHUNK_SIZE, diff_usec(start, gettime()));
+    } else {
+        printf("Hardware SHA engine unavailable.\n");
+    }
+
+    /* Key candidate verification: lots of 16-byte inputs */
+    start = gettime();
+    for(u32 offset = 0; (offset + 16) <= size; offset += 16) SHA1(buf + offset, 16, hash);
+    PrintThroughput("16-byte inputs:", size, diff_usec(start, gettime()));
+
+    printf("\n");
+}
+
+static void SaveBenchmarkResults(void)
+{
+    char path[64] = {0};
+
+    printf("Select a storage device to save the results to, or press HOME / Start to skip.\n");
+
+    if (SelectStorageDevice() < 0)
+    {
+        printf("\n\n");
+        return;
+    }
+
+    sprintf(path, "%s:/xyzzy", StorageDeviceMountName());
+    mkdir(path, 0777);
+
+    sprintf(path + strlen(path), "/%s", CRYPTOBENCH_FILENAME);
+    printf("\n\nSaving results to \"%s\"... %s\n\n", path, SaveCryptoBenchmarkResults(path) ? "OK!" : "FAILED!");
+
+    UnmountStorageDevice();
+}
+
+void RunBenchmarks(void)
+{
+    PrintHeadline();
+    printf("Running benchmarks, please wait...\n\n");
+
+    u8 *buf = memalign(SHA_HW_ALIGNMENT, BENCHMARK_BUF_SIZE);
+    if (!buf)
+    {
+        printf("Error allocating memory for benchmark buffer.\n\n");
+        goto out;
+    }
+
+    FillBufferWithPseudoRandomData(buf, BENCHMARK_BUF_SIZE);
+
+    if (!RunCryptoKnownAnswerTests()) printf("One or more known answer tests failed!\n\n");
+
+    BenchmarkKeyScanner(buf, BENCHMARK_BUF_SIZE);
+    BenchmarkAESDecryption(buf, BENCHMARK_BUF_SIZE);
+    BenchmarkAncastWorkload(buf, BENCHMARK_BUF_SIZE);
+    BenchmarkSHA1(buf, BENCHMARK_BUF_SIZE);
+
+    RunCryptoThroughputTests(buf, BENCHMARK_BUF_SIZE);
+
+    SaveBenchmarkResults();
+
+out:
+    if (buf) free(buf);
+
+    printf("Press any button to continue.");
+    WaitForButtonPress(NULL, NULL);
+}
+
+#endif /* XYZZY_BENCHMARK */
@@ -0,0 +1,11 @@
+#ifndef __BENCHMARK_H__
+#define __BENCHMARK_H__
+
+/* Only available if the application was built using "make BENCHMARK=1". */
+#ifdef XYZZY_BENCHMARK
+
+void RunBenchmarks(void);
+
+#endif /* XYZZY_BENCHMARK */
+
+#endif /* __BENCHMARK_H__ */
@@ -0,0 +1,37 @@
+#include <string.h>
+
+#include "blockdev.h"
+
+u32 blockdev_read(const blockdev_t *dev, void *dst, u32 offset, u32 size)
+{
+    if (!dev || !dev->read_block || !dev->block_size || dev->block_size > BLOCKDEV_MAX_BLOCK_SIZE || !dst || offset >= dev->size || !size || \
+        (offset + size) > dev->size) return 0;
+
+    u8 *ptr = (u8*)dst;
+    u8 val[BLOCKDEV_MAX_BLOCK_SIZE] = {0};
+    u32 block = (offset / dev->block_size), block_offset = (offset % dev->block_size), cur_offset = 0;
+
+    // Handle unaligned read at start address
+    if (block_offset)
+    {
+        u32 chunk = (dev->block_size - block_offset);
+        if (chunk > size) chunk = size;
+
+        dev->read_block(dev->priv, block++, val);
+        memcpy(ptr, val + block_offset, chunk);
+        cur_offset += chunk;
+    }
+
+    // Read whole blocks straight into the destination buffer
+    for(; (size - cur_offset) >= dev->block_size; block++, cur_offset += dev->block_size) dev->read_block(dev->priv, block, ptr + cur_offset);
+
+    // Handle unaligned read at end address
+    if (cur_offset < size)
+    {
+        dev->read_block(dev->priv, block, val);
+        memcpy(ptr + cur_offset, val, size - cur_offset);
+        cur_offset = size;
+    }
+
+    return cur_offset;
+}
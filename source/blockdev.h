@@ -0,0 +1,27 @@
+#ifndef __BLOCKDEV_H__
+#define __BLOCKDEV_H__
+
+#include <gctypes.h>
+
+#define BLOCKDEV_MAX_BLOCK_SIZE 4
+
+/* Block contents are stored in big endian order, which is how the PPC sees them on a console. */
+#define BLOCKDEV_PUT_BE16(p, v) do { (p)[0] = (u8)((v) >> 8); (p)[1] = (u8)(v); } while(0)
+#define BLOCKDEV_PUT_BE32(p, v) do { (p)[0] = (u8)((v) >> 24); (p)[1] = (u8)((v) >> 16); (p)[2] = (u8)((v) >> 8); (p)[3] = (u8)(v); } while(0)
+
+/* Reads a single block from the device into the provided buffer, which may not be aligned. */
+typedef void (*blockdev_read_block_fn)(void *priv, u32 block, u8 *out);
+
+/* Describes a device that can only be read in fixed-size blocks (OTP banks, SEEPROM, SRAM mirrors...). */
+typedef struct {
+    u32 block_size;                         // Must not exceed BLOCKDEV_MAX_BLOCK_SIZE.
+    u32 size;                               // Total device size, in bytes.
+    blockdev_read_block_fn read_block;
+    void *priv;                             // Passed as is to read_block.
+} blockdev_t;
+
+/* Reads an arbitrary byte range from the provided device. Whole blocks are read straight into the destination buffer, */
+/* and only the unaligned head and tail go through an intermediate block. Returns the number of bytes read (0 on error). */
+u32 blockdev_read(const blockdev_t *dev, void *dst, u32 offset, u32 size);
+
+#endif /* __BLOCKDEV_H__ */
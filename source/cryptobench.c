@@ -0,0 +1,273 @@
+#ifdef XYZZY_BENCHMARK
+
+#include <stdlib.h>
+#include <string.h>
+#include <gccore.h>
+#include <ogc/lwp_watchdog.h>
+
+#include "tools.h"
+#include "cryptobench.h"
+#include "aes.h"
+#include "sha1.h"
+#include "xxhash.h"
+
+#define CRYPTOBENCH_MIB             0x100000
+#define CRYPTOBENCH_MIN_WORKLOAD    (4 * CRYPTOBENCH_MIB)   // Each throughput run processes at least this much data.
+#define CRYPTOBENCH_MAX_RESULTS     64
+
+typedef struct {
+    const char *kind;       // "kat" or "speed".
+    const char *primitive;
+    u32 size;
+    u32 value;              // Pass / fail for known answer tests, hundredths of a MiB per second for throughput runs.
+} cryptobench_result_t;
+
+typedef struct {
+    const char *name;
+    const char *msg;
+    u32 repeat;
+    u8 digest[SHA1HashSize];
+} sha1_kat_t;
+
+typedef struct {
+    const char *msg;
+    u32 seed;
+    u32 hash;
+} xxh32_kat_t;
+
+/* NIST SP 800-38A, F.2.1 and F.2.2 (CBC-AES128) */
+static const u8 aes_kat_key[AES_BLOCK_SIZE] = { 0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6, 0xAB, 0xF7, 0x15, 0x88, 0x09, 0xCF, 0x4F, 0x3C };
+static const u8 aes_kat_iv[AES_BLOCK_SIZE]  = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F };
+
+static const u8 aes_kat_pt[AES_BLOCK_SIZE * 4] = {
+    0x6B, 0xC1, 0xBE, 0xE2, 0x2E, 0x40, 0x9F, 0x96, 0xE9, 0x3D, 0x7E, 0x11, 0x73, 0x93, 0x17, 0x2A,
+    0xAE, 0x2D, 0x8A, 0x57, 0x1E, 0x03, 0xAC, 0x9C, 0x9E, 0xB7, 0x6F, 0xAC, 0x45, 0xAF, 0x8E, 0x51,
+    0x30, 0xC8, 0x1C, 0x46, 0xA3, 0x5C, 0xE4, 0x11, 0xE5, 0xFB, 0xC1, 0x19, 0x1A, 0x0A, 0x52, 0xEF,
+    0xF6, 0x9F, 0x24, 0x45, 0xDF, 0x4F, 0x9B, 0x17, 0xAD, 0x2B, 0x41, 0x7B, 0xE6, 0x6C, 0x37, 0x10
+};
+
+static const u8 aes_kat_ct[AES_BLOCK_SIZE * 4] = {
+    0x76, 0x49, 0xAB, 0xAC, 0x81, 0x19, 0xB2, 0x46, 0xCE, 0xE9, 0x8E, 0x9B, 0x12, 0xE9, 0x19, 0x7D,
+    0x50, 0x86, 0xCB, 0x9B, 0x50, 0x72, 0x19, 0xEE, 0x95, 0xDB, 0x11, 0x3A, 0x91, 0x76, 0x78, 0xB2,
+    0x73, 0xBE, 0xD6, 0xB8, 0xE3, 0xC1, 0x74, 0x3B, 0x71, 0x16, 0xE6, 0x9E, 0x22, 0x22, 0x95, 0x16,
+    0x3F, 0xF1, 0xCA, 0xA1, 0x68, 0x1F, 0xAC, 0x09, 0x12, 0x0E, 0xCA, 0x30, 0x75, 0x86, 0xE1, 0xA7
+};
+
+/* FIPS 180-2, appendix A, plus the empty message */
+static const sha1_kat_t sha1_kats[] = {
+    {
+        .name = "sha1-empty",
+        .msg = "",
+        .repeat = 1,
+        .digest = { 0xDA, 0x39, 0xA3, 0xEE, 0x5E, 0x6B, 0x4B, 0x0D, 0x32, 0x55, 0xBF, 0xEF, 0x95, 0x60, 0x18, 0x90, 0xAF, 0xD8, 0x07, 0x09 }
+    },
+    {
+        .name = "sha1-abc",
+        .msg = "abc",
+        .repeat = 1,
+        .digest = { 0xA9, 0x99, 0x3E, 0x36, 0x47, 0x06, 0x81, 0x6A, 0xBA, 0x3E, 0x25, 0x71, 0x78, 0x50, 0xC2, 0x6C, 0x9C, 0xD0, 0xD8, 0x9D }
+    },
+    {
+        .name = "sha1-448bit",
+        .msg = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+        .repeat = 1,
+        .digest = { 0x84, 0x98, 0x3E, 0x44, 0x1C, 0x3B, 0xD2, 0x6E, 0xBA, 0xAE, 0x4A, 0xA1, 0xF9, 0x51, 0x29, 0xE5, 0xE5, 0x46, 0x70, 0xF1 }
+    },
+    {
+        .name = "sha1-million-a",
+        .msg = "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa",
+        .repeat = 10000,
+        .digest = { 0x34, 0xAA, 0x97, 0x3C, 0xD4, 0xC4, 0xDA, 0xA4, 0xF6, 0x1E, 0xEB, 0x2B, 0xDB, 0xAD, 0x27, 0x31, 0x65, 0x34, 0x01, 0x6F }
+    }
+};
+
+/* xxHash reference sanity checks */
+static const xxh32_kat_t xxh32_kats[] = {
+    { "", 0, 0x02CC5D05 },
+    { "", 0x9E3779B1, 0x36B78AE7 },
+    { "abc", 0, 0x32D153FF },
+    { "Nobody inspects the spammish repetition", 0, 0xE2293B2F }
+};
+
+static const u32 cryptobench_sizes[] = { 16, 64, 1024, 0x10000, CRYPTOBENCH_MIB, 4 * CRYPTOBENCH_MIB };
+
+static cryptobench_result_t results[CRYPTOBENCH_MAX_RESULTS] = {0};
+static u32 results_count = 0;
+
+static void RecordResult(const char *kind, const char *primitive, u32 size, u32 value)
+{
+    if (results_count >= CRYPTOBENCH_MAX_RESULTS) return;
+
+    cryptobench_result_t *result = &(results[results_count++]);
+    result->kind = kind;
+    result->primitive = primitive;
+    result->size = size;
+    result->value = value;
+}
+
+static bool RecordKnownAnswerTest(const char *name, u32 size, bool passed)
+{
+    printf("\t- %-28s %s.\n", name, passed ? "OK" : "FAILED");
+    RecordResult("kat", name, size, passed ? 1 : 0);
+    return passed;
+}
+
+static bool RunAesKnownAnswerTests(void)
+{
+    u8 ATTRIBUTE_ALIGN(32) buf[sizeof(aes_kat_pt) + 1] = {0};
+    bool success = true;
+
+    /* The aligned pass goes through the hardware AES engine if it's available, while the misaligned one always uses the software implementation */
+    for(u32 i = 0; i < 2; i++)
+    {
+        u8 *data = (buf + i);
+
+        memcpy(data, aes_kat_pt, sizeof(aes_kat_pt));
+        success &= RecordKnownAnswerTest(i ? "aes-128-cbc-encrypt-sw" : "aes-128-cbc-encrypt", sizeof(aes_kat_pt), \
+                                         aes_128_cbc_encrypt(aes_kat_key, aes_kat_iv, data, sizeof(aes_kat_pt)) == 0 && \
+                                         !memcmp(data, aes_kat_ct, sizeof(aes_kat_ct)));
+
+        memcpy(data, aes_kat_ct, sizeof(aes_kat_ct));
+        success &= RecordKnownAnswerTest(i ? "aes-128-cbc-decrypt-sw" : "aes-128-cbc-decrypt", sizeof(aes_kat_ct), \
+                                         aes_128_cbc_decrypt(aes_kat_key, aes_kat_iv, data, sizeof(aes_kat_ct)) == 0 && \
+                                         !memcmp(data, aes_kat_pt, sizeof(aes_kat_pt)));
+    }
+
+    return success;
+}
+
+static bool RunSha1KnownAnswerTests(void)
+{
+    SHA1Context ctx = {0};
+    sha1 hash = {0};
+    bool success = true;
+
+    for(u32 i = 0; i < MAX_ELEMENTS(sha1_kats); i++)
+    {
+        const sha1_kat_t *kat = &(sha1_kats[i]);
+        u32 msg_len = strlen(kat->msg);
+        bool passed = (SHA1Reset(&ctx) == shaSuccess);
+
+        for(u32 j = 0; j < kat->repeat && passed; j++) passed = (SHA1Input(&ctx, (u8*)kat->msg, msg_len) == shaSuccess);
+
+        passed = (passed && SHA1Result(&ctx, hash) == shaSuccess && !memcmp(hash, kat->digest, SHA1HashSize));
+
+        success &= RecordKnownAnswerTest(kat->name, msg_len * kat->repeat, passed);
+    }
+
+    /* Single block fast path */
+    success &= RecordKnownAnswerTest("sha1-short-abc", 3, SHA1Short((const u8*)sha1_kats[1].msg, 3, hash) == shaSuccess && \
+                                     !memcmp(hash, sha1_kats[1].digest, SHA1HashSize));
+
+    return success;
+}
+
+static bool RunXxh32KnownAnswerTests(void)
+{
+    bool success = true;
+
+    for(u32 i = 0; i < MAX_ELEMENTS(xxh32_kats); i++)
+    {
+        const xxh32_kat_t *kat = &(xxh32_kats[i]);
+        u32 msg_len = strlen(kat->msg);
+        success &= RecordKnownAnswerTest("xxh32", msg_len, XXH32(kat->msg, msg_len, kat->seed) == kat->hash);
+    }
+
+    return success;
+}
+
+bool RunCryptoKnownAnswerTests(void)
+{
+    bool success = true;
+
+    printf("Known answer tests:\n");
+
+    success &= RunAesKnownAnswerTests();
+    success &= RunSha1KnownAnswerTests();
+    success &= RunXxh32KnownAnswerTests();
+
+    printf("\n");
+
+    return success;
+}
+
+static void RecordThroughput(const char *primitive, u32 size, u64 total_size, u64 elapsed_us)
+{
+    /* Hundredths of a MiB per second */
+    u32 rate = (elapsed_us ? (u32)((total_size * 100 * 1000000) / (elapsed_us * CRYPTOBENCH_MIB)) : 0);
+    printf("\t- %-16s %8u B: %5u.%02u MiB/s.\n", primitive, size, rate / 100, rate % 100);
+    RecordResult("speed", primitive, size, rate);
+}
+
+void RunCryptoThroughputTests(u8 *buf, u32 size)
+{
+    if (!buf || !size) return;
+
+    u8 key[AES_BLOCK_SIZE] = {0}, iv[AES_BLOCK_SIZE] = {0};
+    sha1 hash = {0};
+    u64 start = 0;
+    u32 xxhash = 0;
+
+    for(u32 i = 0; i < size; i++) buf[i] = (u8)(i * 0x9D + 0x5B);
+
+    printf("Throughput:\n");
+
+    for(u32 i = 0; i < MAX_ELEMENTS(cryptobench_sizes); i++)
+    {
+        u32 cur_size = cryptobench_sizes[i];
+        if (cur_size > size) break;
+
+        /* Small inputs get processed many times over, so the timer resolution doesn't skew the results */
+        u32 iterations = (cur_size < CRYPTOBENCH_MIN_WORKLOAD ? (CRYPTOBENCH_MIN_WORKLOAD / cur_size) : 1);
+        u64 total_size = ((u64)cur_size * iterations);
+
+        start = gettime();
+        for(u32 j = 0; j < iterations; j++) aes_128_cbc_encrypt(key, iv, buf, cur_size);
+        RecordThroughput("aes-128-cbc-enc", cur_size, total_size, diff_usec(start, gettime()));
+
+        start = gettime();
+        for(u32 j = 0; j < iterations; j++) aes_128_cbc_decrypt(key, iv, buf, cur_size);
+        RecordThroughput("aes-128-cbc-dec", cur_size, total_size, diff_usec(start, gettime()));
+
+        start = gettime();
+        for(u32 j = 0; j < iterations; j++) SHA1(buf, cur_size, hash);
+        RecordThroughput("sha1", cur_size, total_size, diff_usec(start, gettime()));
+
+        start = gettime();
+        for(u32 j = 0; j < iterations; j++) xxhash ^= XXH32(buf, cur_size, j);
+        RecordThroughput("xxh32", cur_size, total_size, diff_usec(start, gettime()));
+    }
+
+    /* Keep the XXH32 loop from being optimized away */
+    buf[0] ^= (u8)xxhash;
+
+    printf("\n");
+}
+
+bool SaveCryptoBenchmarkResults(const char *path)
+{
+    if (!path || !strlen(path) || !results_count) return false;
+
+    FILE *fp = fopen(path, "w");
+    if (!fp) return false;
+
+    fprintf(fp, "kind,primitive,size,result\r\n");
+
+    for(u32 i = 0; i < results_count; i++)
+    {
+        const cryptobench_result_t *result = &(results[i]);
+
+        if (!strcmp(result->kind, "kat"))
+        {
+            fprintf(fp, "%s,%s,%u,%s\r\n", result->kind, result->primitive, result->size, result->value ? "pass" : "fail");
+        } else {
+            fprintf(fp, "%s,%s,%u,%u.%02u\r\n", result->kind, result->primitive, result->size, result->value / 100, result->value % 100);
+        }
+    }
+
+    fclose(fp);
+
+    return true;
+}
+
+#endif /* XYZZY_BENCHMARK */
@@ -0,0 +1,24 @@
+#ifndef __CRYPTOBENCH_H__
+#define __CRYPTOBENCH_H__
+
+#include <gctypes.h>
+
+/* Only available if the application was built using "make BENCHMARK=1". */
+#ifdef XYZZY_BENCHMARK
+
+#define CRYPTOBENCH_FILENAME    "benchmark.csv"
+
+/* Checks AES-128-CBC, SHA-1 and XXH32 against known answer vectors from NIST SP 800-38A, FIPS 180 and the xxHash reference implementation. */
+/* Both the hardware and software AES paths are checked. Returns false if any of them fails. */
+bool RunCryptoKnownAnswerTests(void);
+
+/* Measures the throughput of each primitive for input sizes ranging from 16 bytes up to the provided buffer size. */
+/* The buffer must be aligned to a 64-byte boundary. Its contents are overwritten. */
+void RunCryptoThroughputTests(u8 *buf, u32 size);
+
+/* Saves every result recorded so far to the provided path as CSV, using one "kind,primitive,size,result" record per line. */
+bool SaveCryptoBenchmarkResults(const char *path);
+
+#endif /* XYZZY_BENCHMARK */
+
+#endif /* __CRYPTOBENCH_H__ */
@@ -0,0 +1,48 @@
+#include <string.h>
+#include <gccore.h>
+
+#include "dol.h"
+
+static bool IsValidDOLSection(u32 offset, u32 size, u32 dol_size)
+{
+    /* Empty sections are fine, as long as their offset is zeroed as well */
+    if (!size) return true;
+    return (offset >= sizeof(dol_header_t) && offset < dol_size && size <= (dol_size - offset));
+}
+
+u32 GetDOLDataSectionRanges(const dol_header_t *dol_header, u32 dol_size, keyscan_range_t *out, u32 max_count)
+{
+    if (!dol_header || dol_size <= sizeof(dol_header_t) || !out || max_count < DOL_DATA_SECTION_COUNT) return 0;
+
+    u32 count = 0;
+
+    /* Every DOL needs at least one text section and an entry point */
+    if (!dol_header->text_size[0] || !dol_header->entry_point) return 0;
+
+    for(u32 i = 0; i < DOL_TEXT_SECTION_COUNT; i++)
+    {
+        if (!IsValidDOLSection(dol_header->text_offset[i], dol_header->text_size[i], dol_size)) return 0;
+    }
+
+    for(u32 i = 0; i < DOL_DATA_SECTION_COUNT; i++)
+    {
+        u32 offset = dol_header->data_offset[i], size = dol_header->data_size[i];
+
+        if (!IsValidDOLSection(offset, size, dol_size)) return 0;
+        if (!size) continue;
+
+        /* Insert the current section while keeping our ranges sorted by offset */
+        u32 j = count;
+        while(j > 0 && out[j - 1].offset > offset)
+        {
+            out[j] = out[j - 1];
+            j--;
+        }
+
+        out[j].offset = offset;
+        out[j].size = size;
+        count++;
+    }
+
+    return count;
+}
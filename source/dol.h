@@ -0,0 +1,28 @@
+#ifndef __DOL_H__
+#define __DOL_H__
+
+#include <gctypes.h>
+
+#include "keyscan.h"
+
+#define DOL_TEXT_SECTION_COUNT  7
+#define DOL_DATA_SECTION_COUNT  11
+
+typedef struct {
+    u32 text_offset[DOL_TEXT_SECTION_COUNT];
+    u32 data_offset[DOL_DATA_SECTION_COUNT];
+    u32 text_addr[DOL_TEXT_SECTION_COUNT];
+    u32 data_addr[DOL_DATA_SECTION_COUNT];
+    u32 text_size[DOL_TEXT_SECTION_COUNT];
+    u32 data_size[DOL_DATA_SECTION_COUNT];
+    u32 bss_addr;
+    u32 bss_size;
+    u32 entry_point;
+    u8 padding[0x1C];
+} dol_header_t;
+
+/* Validates the provided DOL header against the full DOL size and fills the output array with the file ranges for all non-empty data sections, sorted by offset. */
+/* Returns the number of ranges written to the output array, or 0 if the header doesn't parse cleanly. */
+u32 GetDOLDataSectionRanges(const dol_header_t *dol_header, u32 dol_size, keyscan_range_t *out, u32 max_count);
+
+#endif /* __DOL_H__ */
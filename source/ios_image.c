@@ -0,0 +1,103 @@
+#include <string.h>
+#include <gccore.h>
+
+#include "tools.h"
+#include "ios_image.h"
+
+#define ELF_MAGIC       (u32)0x7F454C46 // "\x7FELF"
+#define ELFCLASS32      1
+#define ELFDATA2MSB     2
+#define EM_ARM          40
+#define PT_LOAD         1
+#define PF_X            1
+
+#define ELF_MAX_PHNUM   64
+
+typedef struct {
+    u32 e_magic;
+    u8 e_class;
+    u8 e_data;
+    u8 e_ident_pad[10];
+    u16 e_type;
+    u16 e_machine;
+    u32 e_version;
+    u32 e_entry;
+    u32 e_phoff;
+    u32 e_shoff;
+    u32 e_flags;
+    u16 e_ehsize;
+    u16 e_phentsize;
+    u16 e_phnum;
+    u16 e_shentsize;
+    u16 e_shnum;
+    u16 e_shstrndx;
+} elf32_ehdr_t;
+
+typedef struct {
+    u32 p_type;
+    u32 p_offset;
+    u32 p_vaddr;
+    u32 p_paddr;
+    u32 p_filesz;
+    u32 p_memsz;
+    u32 p_flags;
+    u32 p_align;
+} elf32_phdr_t;
+
+static const elf32_phdr_t *GetProgramHeaders(u32 addr, u32 lookup_end, u16 *out_phnum)
+{
+    const elf32_ehdr_t *ehdr = (const elf32_ehdr_t*)addr;
+
+    /* Make sure this is a big endian 32-bit ARM ELF */
+    if (ehdr->e_magic != ELF_MAGIC || ehdr->e_class != ELFCLASS32 || ehdr->e_data != ELFDATA2MSB || ehdr->e_machine != EM_ARM || \
+        ehdr->e_phentsize != sizeof(elf32_phdr_t) || !ehdr->e_phnum || ehdr->e_phnum > ELF_MAX_PHNUM) return NULL;
+
+    /* Make sure the program header table is within our memory extents */
+    if (!IS_ALIGNED(ehdr->e_phoff, 4) || ehdr->e_phoff >= (lookup_end - addr) || \
+        (ehdr->e_phnum * sizeof(elf32_phdr_t)) > (lookup_end - addr - ehdr->e_phoff)) return NULL;
+
+    *out_phnum = ehdr->e_phnum;
+
+    return (const elf32_phdr_t*)(addr + ehdr->e_phoff);
+}
+
+u32 GetIOSModuleSegments(u32 lookup_start, u32 lookup_end, u32 vaddr_start, u32 vaddr_end, ios_segment_t *out, u32 max_count)
+{
+    if (lookup_start >= lookup_end || vaddr_start >= vaddr_end || !out || !max_count) return 0;
+
+    u32 count = 0;
+    u32 phys_start = MEM_VIRTUAL_TO_PHYSICAL(lookup_start), phys_end = MEM_VIRTUAL_TO_PHYSICAL(lookup_end);
+
+    for(u32 addr = lookup_start; addr < lookup_end && (lookup_end - addr) >= sizeof(elf32_ehdr_t) && !count; addr += 4)
+    {
+        /* Look for an ELF header */
+        if (*((u32*)addr) != ELF_MAGIC) continue;
+
+        u16 phnum = 0;
+        const elf32_phdr_t *phdrs = GetProgramHeaders(addr, lookup_end, &phnum);
+        if (!phdrs) continue;
+
+        /* Data segments go first, since that's where we usually find what we're looking for */
+        for(u32 pass = 0; pass < 2; pass++)
+        {
+            for(u16 i = 0; i < phnum && count < max_count; i++)
+            {
+                const elf32_phdr_t *phdr = &(phdrs[i]);
+                bool exec = ((phdr->p_flags & PF_X) != 0);
+
+                if (phdr->p_type != PT_LOAD || !phdr->p_memsz || exec != (pass > 0)) continue;
+
+                /* Only keep segments that belong to the requested module and are fully loaded within our memory extents */
+                if (phdr->p_vaddr < vaddr_start || phdr->p_vaddr >= vaddr_end || phdr->p_paddr < phys_start || phdr->p_paddr >= phys_end || \
+                    phdr->p_memsz > (phys_end - phdr->p_paddr)) continue;
+
+                out[count].addr = (u32)MEM_PHYSICAL_TO_K0(phdr->p_paddr);
+                out[count].size = phdr->p_memsz;
+                out[count].exec = exec;
+                count++;
+            }
+        }
+    }
+
+    return count;
+}
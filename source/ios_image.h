@@ -0,0 +1,23 @@
+#ifndef __IOS_IMAGE_H__
+#define __IOS_IMAGE_H__
+
+#include <gctypes.h>
+
+/* Virtual address range used by the ES module in every known IOS build. */
+#define IOS_ES_MODULE_VADDR_START   0x20100000
+#define IOS_ES_MODULE_VADDR_END     0x20200000
+
+#define IOS_MAX_MODULE_SEGMENTS     8
+
+typedef struct {
+    u32 addr;       // PPC-accessible (cached) address.
+    u32 size;
+    bool exec;      // Set for code segments.
+} ios_segment_t;
+
+/* Looks for the program headers from the IOS ELF image loaded within the provided MEM2 range, and fills the output array with the loadable segments */
+/* whose virtual address falls within [vaddr_start, vaddr_end) and which are fully contained within the provided MEM2 range. */
+/* Data segments are placed before code segments. Returns the number of segments written to the output array. */
+u32 GetIOSModuleSegments(u32 lookup_start, u32 lookup_end, u32 vaddr_start, u32 vaddr_end, ios_segment_t *out, u32 max_count);
+
+#endif /* __IOS_IMAGE_H__ */
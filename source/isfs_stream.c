@@ -0,0 +1,141 @@
+#include <gccore.h>
+#include <string.h>
+#include <ogc/machine/processor.h>
+
+#include "tools.h"
+#include "isfs_stream.h"
+#include "aes_hw.h"
+#include "sha_hw.h"
+
+static s32 FlashFileSystemStreamCallback(s32 result, void *usrdata)
+{
+    isfs_stream_t *stream = (isfs_stream_t*)usrdata;
+
+    stream->result = result;
+    stream->busy = false;
+    LWP_ThreadSignal(stream->queue);
+
+    return 0;
+}
+
+static s32 WaitForFlashFileSystemStream(isfs_stream_t *stream)
+{
+    u32 level = 0;
+
+    _CPU_ISR_Disable(level);
+    while(stream->busy) LWP_ThreadSleep(stream->queue);
+    _CPU_ISR_Restore(level);
+
+    return stream->result;
+}
+
+static s32 IssueFlashFileSystemStreamRead(isfs_stream_t *stream)
+{
+    u32 size = (stream->end - stream->next);
+    if (size > stream->chunk_size) size = stream->chunk_size;
+
+    stream->pending_size = size;
+    if (!size) return 0;
+
+    stream->result = 0;
+    stream->busy = true;
+
+    s32 ret = ISFS_ReadAsync(stream->fd, stream->buf[stream->cur], size, FlashFileSystemStreamCallback, stream);
+    if (ret < 0)
+    {
+        stream->busy = false;
+        stream->pending_size = 0;
+        return ret;
+    }
+
+    stream->next += size;
+
+    return 0;
+}
+
+s32 StartFlashFileSystemStream(isfs_stream_t *stream, s32 fd, u32 offset, u32 size, u8 *buf0, u8 *buf1, u32 chunk_size)
+{
+    if (!stream) return ISFS_EINVAL;
+
+    s32 ret = 0;
+
+    /* Make sure StopFlashFileSystemStream() can always be called afterwards */
+    memset(stream, 0, sizeof(isfs_stream_t));
+    stream->queue = LWP_TQUEUE_NULL;
+
+    if (fd < 0 || !buf0 || !buf1 || buf0 == buf1 || !IS_ALIGNED((u32)buf0, 32) || !IS_ALIGNED((u32)buf1, 32) || !chunk_size || \
+        !IS_ALIGNED(chunk_size, 32)) return ISFS_EINVAL;
+
+    stream->fd = fd;
+    stream->buf[0] = buf0;
+    stream->buf[1] = buf1;
+    stream->chunk_size = chunk_size;
+    stream->offset = stream->next = offset;
+    stream->end = (offset + size);
+
+    /* Whatever the caller does with each chunk while the next one is being read must stay away from the engines IOS is using */
+    aes_hw_hold();
+    sha_hw_hold();
+    stream->engines_held = true;
+
+    LWP_InitQueue(&(stream->queue));
+
+    ret = ISFS_Seek(fd, offset, SEEK_SET);
+    if (ret >= 0) ret = IssueFlashFileSystemStreamRead(stream);
+
+    if (ret < 0)
+    {
+        LWP_CloseQueue(stream->queue);
+        stream->queue = LWP_TQUEUE_NULL;
+    }
+
+    return ret;
+}
+
+s32 ReadFlashFileSystemStream(isfs_stream_t *stream, u8 **out_chunk)
+{
+    if (!stream || stream->queue == LWP_TQUEUE_NULL || !out_chunk) return ISFS_EINVAL;
+
+    if (!stream->pending_size) return 0;
+
+    u32 size = stream->pending_size;
+    u8 *chunk = stream->buf[stream->cur];
+
+    s32 ret = WaitForFlashFileSystemStream(stream);
+    stream->pending_size = 0;
+
+    if (ret < 0) return ret;
+    if (ret != (s32)size) return ISFS_EINVAL;
+
+    /* Get IOS started on the next chunk right away, using the other buffer */
+    stream->cur ^= 1;
+    ret = IssueFlashFileSystemStreamRead(stream);
+    if (ret < 0) return ret;
+
+    stream->offset += size;
+    *out_chunk = chunk;
+
+    return (s32)size;
+}
+
+void StopFlashFileSystemStream(isfs_stream_t *stream)
+{
+    if (!stream) return;
+
+    if (stream->queue != LWP_TQUEUE_NULL)
+    {
+        /* IOS could still be writing to one of our buffers */
+        if (stream->pending_size) WaitForFlashFileSystemStream(stream);
+        stream->pending_size = 0;
+
+        LWP_CloseQueue(stream->queue);
+        stream->queue = LWP_TQUEUE_NULL;
+    }
+
+    if (stream->engines_held)
+    {
+        sha_hw_release();
+        aes_hw_release();
+        stream->engines_held = false;
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef __ISFS_STREAM_H__
+#define __ISFS_STREAM_H__
+
+#include <gctypes.h>
+#include <ogc/lwp.h>
+
+/* Double-buffered sequential reader for NAND files. While the caller works on the chunk it just got, the next one is already being read by IOS. */
+/* All state lives in this struct, so multiple streams may be used at once, as long as each one has its own file descriptor. */
+typedef struct {
+    s32 fd;
+    u8 *buf[2];             // Must be aligned to a 32-byte boundary. Each one must be able to hold chunk_size bytes.
+    u32 chunk_size;         // Must be a multiple of 32.
+    u32 offset;             // File offset of the data returned by the next ReadFlashFileSystemStream() call.
+    u32 end;                // File offset where the stream ends.
+    u32 next;               // File offset of the next read request to be issued.
+    u32 cur;                // Index of the buffer the pending read request is writing to.
+    u32 pending_size;
+    volatile s32 result;
+    volatile bool busy;
+    lwpq_t queue;
+    bool engines_held;      // IOS uses the AES and SHA engines for NAND reads, so they're held off while the stream is active.
+} isfs_stream_t;
+
+/* Seeks the provided file to the provided offset and issues the first read request. The AES and SHA engines are held off until the stream is stopped. */
+/* The file must have been opened with OpenFileFromFlashFileSystem(). */
+/* Returns a negative ISFS error code on failure. */
+s32 StartFlashFileSystemStream(isfs_stream_t *stream, s32 fd, u32 offset, u32 size, u8 *buf0, u8 *buf1, u32 chunk_size);
+
+/* Waits for the pending read request, issues the next one (if needed) and saves a pointer to the retrieved chunk. */
+/* The chunk stays valid until the next call. Returns the chunk size, 0 if the stream is over, or a negative ISFS error code on failure. */
+s32 ReadFlashFileSystemStream(isfs_stream_t *stream, u8 **out_chunk);
+
+/* Waits for any pending read request. Must always be called once the stream is no longer needed, even if it wasn't fully read or couldn't be started. */
+void StopFlashFileSystemStream(isfs_stream_t *stream);
+
+#endif /* __ISFS_STREAM_H__ */
@@ -0,0 +1,159 @@
+#include <stdlib.h>
+#include <string.h>
+#include <gccore.h>
+
+#include "tools.h"
+#include "keyhints.h"
+
+#define KEYHINTS_ALLOC_STEP 16
+
+static key_hint_t *hints = NULL;
+static u32 hints_count = 0, hints_alloc = 0;
+static bool hints_dirty = false;
+
+/* Lookups and updates may come from concurrently running extraction stages. Created by LoadKeyHints() before any of them starts */
+static mutex_t hints_mutex = LWP_MUTEX_NULL;
+
+static void LockKeyHints(void)
+{
+    LWP_MutexLock(hints_mutex);
+}
+
+static void UnlockKeyHints(void)
+{
+    LWP_MutexUnlock(hints_mutex);
+}
+
+static const key_hint_t *FindKeyHint(const key_hint_t *list, u32 count, const char *context, const char *name)
+{
+    for(u32 i = 0; i < count; i++)
+    {
+        if (!strcmp(list[i].context, context) && !strcmp(list[i].name, name)) return &(list[i]);
+    }
+
+    return NULL;
+}
+
+static bool AppendKeyHint(const char *context, const char *name, u32 offset)
+{
+    if (hints_count >= hints_alloc)
+    {
+        key_hint_t *tmp = realloc(hints, (hints_alloc + KEYHINTS_ALLOC_STEP) * sizeof(key_hint_t));
+        if (!tmp) return false;
+
+        hints = tmp;
+        hints_alloc += KEYHINTS_ALLOC_STEP;
+    }
+
+    key_hint_t *hint = &(hints[hints_count++]);
+
+    snprintf(hint->context, KEYHINT_CONTEXT_LENGTH, "%s", context);
+    snprintf(hint->name, KEYHINT_NAME_LENGTH, "%s", name);
+    hint->offset = offset;
+
+    return true;
+}
+
+bool LoadKeyHints(const char *path)
+{
+    /* Lookups and updates need the lock even if there's no file to load */
+    if (hints_mutex == LWP_MUTEX_NULL) LWP_MutexInit(&hints_mutex, false);
+
+    if (!path || !strlen(path)) return false;
+
+    FILE *fp = fopen(path, "r");
+    if (!fp) return false;
+
+    char line[0x100] = {0};
+    char context[KEYHINT_CONTEXT_LENGTH] = {0}, name[KEYHINT_NAME_LENGTH] = {0};
+    u32 offset = 0;
+
+    while(fgets(line, sizeof(line), fp))
+    {
+        /* Skip comments, empty lines and malformed entries */
+        if (line[0] == '#' || sscanf(line, "%63s %31s %x", context, name, &offset) != 3) continue;
+
+        /* Later entries take precedence over earlier ones */
+        key_hint_t *hint = (key_hint_t*)FindKeyHint(hints, hints_count, context, name);
+        if (hint)
+        {
+            hint->offset = offset;
+        } else {
+            AppendKeyHint(context, name, offset);
+        }
+    }
+
+    fclose(fp);
+
+    hints_dirty = false;
+
+    return true;
+}
+
+bool SaveKeyHints(const char *path)
+{
+    if (!path || !strlen(path)) return false;
+
+    if (!hints_dirty) return true;
+
+    FILE *fp = fopen(path, "w");
+    if (!fp) return false;
+
+    fprintf(fp, "# context name offset\r\n");
+    for(u32 i = 0; i < hints_count; i++) fprintf(fp, "%s %s 0x%08X\r\n", hints[i].context, hints[i].name, hints[i].offset);
+
+    fclose(fp);
+
+    hints_dirty = false;
+
+    return true;
+}
+
+bool LookupKeyHint(const char *context, const char *name, u32 *out_offset)
+{
+    if (!context || !name || !out_offset) return false;
+
+    LockKeyHints();
+
+    const key_hint_t *hint = FindKeyHint(hints, hints_count, context, name);
+    if (hint) *out_offset = hint->offset;
+
+    UnlockKeyHints();
+
+    return (hint != NULL);
+}
+
+void AddKeyHint(const char *context, const char *name, u32 offset)
+{
+    if (!context || !strlen(context) || !name || !strlen(name)) return;
+
+    LockKeyHints();
+
+    key_hint_t *hint = (key_hint_t*)FindKeyHint(hints, hints_count, context, name);
+    if (hint)
+    {
+        if (hint->offset != offset)
+        {
+            hint->offset = offset;
+            hints_dirty = true;
+        }
+
+        goto out;
+    }
+
+    if (AppendKeyHint(context, name, offset)) hints_dirty = true;
+
+out:
+    UnlockKeyHints();
+}
+
+void FreeKeyHints(void)
+{
+    if (hints) free(hints);
+    hints = NULL;
+    hints_count = hints_alloc = 0;
+    hints_dirty = false;
+
+    if (hints_mutex != LWP_MUTEX_NULL) LWP_MutexDestroy(hints_mutex);
+    hints_mutex = LWP_MUTEX_NULL;
+}
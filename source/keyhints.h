@@ -0,0 +1,36 @@
+#ifndef __KEYHINTS_H__
+#define __KEYHINTS_H__
+
+#include <gctypes.h>
+
+#define KEYHINTS_FILENAME       "hints.txt"
+
+#define KEYHINT_CONTEXT_LENGTH  64
+#define KEYHINT_NAME_LENGTH     32
+
+/* Each hint maps a key name to the offset it was found at within a given context (e.g. a specific IOS or System Menu build). */
+/* Hints are loaded from / saved to a text file with one "context name offset" entry per line. IOS offsets (e.g. "sd_key" and "isfs_perm") */
+/* are relative to MEM2_IOS_LOOKUP_START. */
+typedef struct {
+    char context[KEYHINT_CONTEXT_LENGTH];
+    char name[KEYHINT_NAME_LENGTH];
+    u32 offset;
+} key_hint_t;
+
+/* Loads hints from the provided text file. Malformed lines are skipped. Returns false if the file couldn't be opened. */
+/* Must be called before any other function from this file, and before any thread that looks up or adds hints is started. */
+bool LoadKeyHints(const char *path);
+
+/* Saves all hints to the provided text file, but only if hints were added or updated since they were loaded. */
+bool SaveKeyHints(const char *path);
+
+/* Looks up a hint for the provided context and key name. */
+bool LookupKeyHint(const char *context, const char *name, u32 *out_offset);
+
+/* Adds a new hint or updates an existing one. */
+void AddKeyHint(const char *context, const char *name, u32 offset);
+
+/* Frees all hints. */
+void FreeKeyHints(void);
+
+#endif /* __KEYHINTS_H__ */
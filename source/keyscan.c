@@ -0,0 +1,196 @@
+#include <string.h>
+#include <gccore.h>
+
+#include "tools.h"
+#include "keyscan.h"
+#include "xxhash.h"
+
+#define KEYSCAN_GET_BE32(p)             (((u32)(p)[0] << 24) | ((u32)(p)[1] << 16) | ((u32)(p)[2] << 8) | (u32)(p)[3])
+#define KEYSCAN_PREFILTER_RESIDUE(p)    ((KEYSCAN_GET_BE32(p) * KEYSCAN_PREFILTER_MUL) >> (32 - KEYSCAN_PREFILTER_BITS))
+
+static bool IsValidKeyInfo(const additional_keyinfo_t *key)
+{
+    return (key && key->key_size > 0 && key->key_size <= sizeof(key->key));
+}
+
+static int HashKeyCandidate(const u8 *ptr, u32 key_size, sha1 hash)
+{
+    /* Every key we look for fits in a single SHA-1 block, and most of them are 16 bytes long */
+    if (key_size == 16) return SHA1_16(ptr, hash);
+    if (key_size <= SHA1ShortMaxSize) return SHA1Short(ptr, key_size, hash);
+    return SHA1((u8*)ptr, key_size, hash);
+}
+
+static bool MatchKey(const u8 *ptr, additional_keyinfo_t *key, u32 xxhash)
+{
+    sha1 hash = {0};
+
+    /* Since the collision potential in XXHash is considerably higher, we'll use software-based SHA1 calculation as a failsafe if we find a XXHash match */
+    /* We will only proceed if both hashes match */
+    if (xxhash != key->xxhash || HashKeyCandidate(ptr, key->key_size, hash) != shaSuccess || memcmp(hash, key->hash, SHA1HashSize) != 0) return false;
+
+    memcpy(key->key, ptr, key->key_size);
+    key->retrieved = true;
+
+    return true;
+}
+
+u16 CalculateKeyPrefilterResidue(const void *key)
+{
+    if (!key) return 0;
+    return (u16)KEYSCAN_PREFILTER_RESIDUE((const u8*)key);
+}
+
+static u32 ScanBufferForKeysAtOffset(const void *buf, u32 buf_size, u32 base_offset, additional_keyinfo_t **keys, u32 key_count)
+{
+    if (!buf || !buf_size || !keys || !key_count) return 0;
+
+    const u8 *data = (const u8*)buf;
+    u32 found = 0, min_key_size = 0, xxhash = 0, xxhash_size = 0;
+
+    bool use_prefilter = true;
+    u32 prefilter[KEYSCAN_PREFILTER_SIZE / 32] = {0};
+
+    for(u32 i = 0; i < key_count; i++)
+    {
+        additional_keyinfo_t *key = keys[i];
+        if (!IsValidKeyInfo(key)) continue;
+
+        if (key->retrieved)
+        {
+            found++;
+            continue;
+        }
+
+        if (!min_key_size || key->key_size < min_key_size) min_key_size = key->key_size;
+
+        /* Keys smaller than a single word can't be prefiltered, so we'll have to check every offset with XXHash */
+        if (key->key_size < KEYSCAN_STRIDE)
+        {
+            use_prefilter = false;
+            continue;
+        }
+
+        u16 residue = (key->prefilter & (KEYSCAN_PREFILTER_SIZE - 1));
+        prefilter[residue >> 5] |= (1U << (residue & 0x1F));
+    }
+
+    /* Bail out if there's nothing left to look for, or if none of the pending keys fit in our buffer */
+    if (found >= key_count || !min_key_size || min_key_size > buf_size) return found;
+
+    for(u32 offset = 0; offset <= (buf_size - min_key_size) && found < key_count; offset += KEYSCAN_STRIDE)
+    {
+        const u8 *ptr = (data + offset);
+        u32 remaining = (buf_size - offset);
+
+        /* Reject the current offset right away if its first word doesn't match any of the prefilter residues */
+        if (use_prefilter)
+        {
+            u32 residue = KEYSCAN_PREFILTER_RESIDUE(ptr);
+            if (!(prefilter[residue >> 5] & (1U << (residue & 0x1F)))) continue;
+        }
+
+        /* Invalidate the cached XXHash checksum, since we're now dealing with a different offset */
+        xxhash_size = 0;
+
+        for(u32 i = 0; i < key_count; i++)
+        {
+            additional_keyinfo_t *key = keys[i];
+
+            /* Skip invalid or already retrieved keys, as well as keys that would exceed our buffer extents */
+            if (!IsValidKeyInfo(key) || key->retrieved || key->key_size > remaining) continue;
+
+            /* Calculate XXHash checksum over the current chunk, but only if we haven't already done so for this key size */
+            if (key->key_size != xxhash_size)
+            {
+                xxhash = XXH32(ptr, key->key_size, 0);
+                xxhash_size = key->key_size;
+            }
+
+            if (!MatchKey(ptr, key, xxhash)) continue;
+
+            key->offset = (base_offset + offset);
+            found++;
+
+            /* Keys don't overlap, so skip the rest of the data we just matched */
+            offset += (ALIGN_UP(key->key_size, KEYSCAN_STRIDE) - KEYSCAN_STRIDE);
+            break;
+        }
+    }
+
+    return found;
+}
+
+u32 ScanBufferForKeys(const void *buf, u32 buf_size, additional_keyinfo_t **keys, u32 key_count)
+{
+    return ScanBufferForKeysAtOffset(buf, buf_size, 0, keys, key_count);
+}
+
+u32 ScanBufferRangesForKeys(const void *buf, u32 buf_size, const keyscan_range_t *ranges, u32 range_count, additional_keyinfo_t **keys, u32 key_count)
+{
+    if (!buf || !buf_size || !ranges || !range_count || !keys || !key_count) return 0;
+
+    u32 found = 0;
+
+    for(u32 i = 0; i < range_count && found < key_count; i++)
+    {
+        u32 offset = ALIGN_DOWN(ranges[i].offset, KEYSCAN_STRIDE);
+        if (offset >= buf_size) continue;
+
+        u32 size = (ranges[i].size + (ranges[i].offset - offset));
+        if (size > (buf_size - offset)) size = (buf_size - offset);
+
+        found = ScanBufferForKeysAtOffset((const u8*)buf + offset, size, offset, keys, key_count);
+    }
+
+    return found;
+}
+
+u32 ScanStreamChunkForKeys(keyscan_stream_t *stream, u8 *chunk, u32 chunk_size, additional_keyinfo_t **keys, u32 key_count)
+{
+    if (!stream || !chunk || !chunk_size || !keys || !key_count) return 0;
+
+    u32 max_key_size = 0, carry_size = 0;
+
+    for(u32 i = 0; i < key_count; i++)
+    {
+        if (IsValidKeyInfo(keys[i]) && !keys[i]->retrieved && keys[i]->key_size > max_key_size) max_key_size = keys[i]->key_size;
+    }
+
+    /* Prepend the data carried over from the previous chunk */
+    u8 *data = (chunk - stream->carry_size);
+    u32 data_size = (stream->carry_size + chunk_size);
+    u32 data_offset = (stream->offset - stream->carry_size);
+
+    if (stream->carry_size) memcpy(data, stream->carry, stream->carry_size);
+
+    u32 found = ScanBufferForKeysAtOffset(data, data_size, data_offset, keys, key_count);
+
+    /* Keys can only start at KEYSCAN_STRIDE-aligned offsets, so carrying over everything past the last offset that could hold a full key is enough */
+    if (found < key_count && max_key_size > KEYSCAN_STRIDE)
+    {
+        carry_size = (ALIGN_UP(max_key_size, KEYSCAN_STRIDE) - KEYSCAN_STRIDE);
+        if (carry_size > data_size) carry_size = ALIGN_DOWN(data_size, KEYSCAN_STRIDE);
+    }
+
+    if (carry_size) memcpy(stream->carry, data + data_size - carry_size, carry_size);
+
+    stream->carry_size = carry_size;
+    stream->offset += chunk_size;
+
+    return found;
+}
+
+bool CheckBufferForKeyAtOffset(const void *buf, u32 buf_size, u32 offset, additional_keyinfo_t *key)
+{
+    if (!buf || !IsValidKeyInfo(key) || offset >= buf_size || key->key_size > (buf_size - offset)) return false;
+
+    if (key->retrieved) return true;
+
+    const u8 *ptr = ((const u8*)buf + offset);
+    if (!MatchKey(ptr, key, XXH32(ptr, key->key_size, 0))) return false;
+
+    key->offset = offset;
+
+    return true;
+}
@@ -0,0 +1,67 @@
+#ifndef __KEYSCAN_H__
+#define __KEYSCAN_H__
+
+#include <gctypes.h>
+
+#include "sha1.h"
+#include "tools.h"
+
+#define KEYSCAN_STRIDE          4
+#define KEYSCAN_MAX_KEY_SIZE    64
+
+/* Amount of headroom needed right before each chunk passed to ScanStreamChunkForKeys(). Big enough to hold the overlap for the largest possible key. */
+/* Kept as a multiple of 32 so the chunk itself stays suitably aligned for IOS reads. */
+#define KEYSCAN_CARRY_SIZE      ALIGN_UP(KEYSCAN_MAX_KEY_SIZE, 32)
+
+/* The prefilter hashes the first big endian word from each candidate and keeps the upper KEYSCAN_PREFILTER_BITS bits from the result. */
+/* Each key descriptor only stores this residue, which is enough to reject almost every offset without embedding any key material. */
+#define KEYSCAN_PREFILTER_BITS  12
+#define KEYSCAN_PREFILTER_MUL   (u32)0x9E3779B1
+#define KEYSCAN_PREFILTER_SIZE  (1 << KEYSCAN_PREFILTER_BITS)
+
+typedef struct {
+    u8 key[KEYSCAN_MAX_KEY_SIZE];
+    u32 key_size;
+    u32 xxhash;
+    u8 hash[SHA1HashSize];
+    u16 prefilter;  // Prefilter residue. Ignored for keys smaller than KEYSCAN_STRIDE.
+    bool retrieved;
+    u32 offset;     // Offset the key was retrieved from, relative to the start of the scanned buffer.
+} additional_keyinfo_t;
+
+/* Describes a range within a buffer, relative to its start. */
+typedef struct {
+    u32 offset;
+    u32 size;
+} keyscan_range_t;
+
+/* Holds the state needed to scan a stream of consecutive chunks, carrying over just enough trailing data to catch keys that straddle chunk boundaries. */
+typedef struct {
+    u32 offset;     // Stream offset for the next chunk.
+    u32 carry_size;
+    u8 carry[KEYSCAN_CARRY_SIZE];
+} keyscan_stream_t;
+
+/* Calculates the prefilter residue for the provided key. Must be at least KEYSCAN_STRIDE bytes long. */
+u16 CalculateKeyPrefilterResidue(const void *key);
+
+/* Looks for all of the provided keys within the provided buffer using a single pass, at KEYSCAN_STRIDE-aligned offsets. */
+/* Each candidate is first checked against the prefilter residues from all pending keys, then using its XXH32 checksum. A SHA-1 checksum is then used as a failsafe to discard collisions. */
+/* Keys that have already been retrieved are skipped. Returns the number of retrieved keys from the provided set, including previously retrieved ones. */
+u32 ScanBufferForKeys(const void *buf, u32 buf_size, additional_keyinfo_t **keys, u32 key_count);
+
+/* Same as ScanBufferForKeys(), but only the provided ranges are scanned, in order. Ranges are clipped to the buffer extents, and their start offsets are aligned down */
+/* to KEYSCAN_STRIDE. Retrieved key offsets are relative to the start of the buffer. */
+u32 ScanBufferRangesForKeys(const void *buf, u32 buf_size, const keyscan_range_t *ranges, u32 range_count, additional_keyinfo_t **keys, u32 key_count);
+
+/* Scans the next chunk from a stream. The stream struct must be zeroed before scanning the first chunk. Its offset may then be set to a KEYSCAN_STRIDE-aligned */
+/* value if the stream doesn't start at the beginning of the underlying data (e.g. when only a range from a file is streamed). */
+/* The KEYSCAN_CARRY_SIZE bytes right before the provided chunk pointer are used to prepend the data carried over from the previous chunk, so they must be writable. */
+/* Every chunk but the last one must have a size that's a multiple of KEYSCAN_STRIDE. Retrieved key offsets are relative to the start of the stream. */
+/* Returns the number of retrieved keys from the provided set, including previously retrieved ones. */
+u32 ScanStreamChunkForKeys(keyscan_stream_t *stream, u8 *chunk, u32 chunk_size, additional_keyinfo_t **keys, u32 key_count);
+
+/* Checks if the provided key is stored at the provided offset within the provided buffer (e.g. from a hint). Keys that have already been retrieved are left untouched. */
+bool CheckBufferForKeyAtOffset(const void *buf, u32 buf_size, u32 offset, additional_keyinfo_t *key);
+
+#endif /* __KEYSCAN_H__ */
@@ -3,6 +3,9 @@
 #include <gccore.h>
 
 #include "tools.h"
+#include "benchmark.h"
+#include "aes_hw.h"
+#include "sha_hw.h"
 
 bool g_isvWii = false;
 
@@ -21,7 +24,17 @@ int main(int argc, char **argv)
 
     g_isvWii = IsWiiU();
 
+    /* Must be done before anything touches the hardware engines */
+    aes_hw_init();
+    sha_hw_init();
+
+    PrintHeadline();
+
+#ifdef XYZZY_BENCHMARK
+    /* Run benchmarks before doing anything else */
+    RunBenchmarks();
     PrintHeadline();
+#endif
 
     /* HW_AHBPROT check */
     if (AHBPROT_DISABLED)
@@ -29,15 +42,9 @@ int main(int argc, char **argv)
         /* Disable memory protection */
         DisableMemoryProtection();
 
-        /* Patch ISFS access permissions */
-        if (PatchNandFsPermissions())
-        {
-            /* Get keys */
-            ret = XyzzyGetKeys();
-            if (ret != -2) printf("\nPress any button to exit.");
-        } else {
-            printf("Failed to patch ISFS access permissions! Press any button to exit.");
-        }
+        /* Get keys. ISFS access permissions are patched once the storage device is available, so known IOS builds can skip the memory scan */
+        ret = XyzzyGetKeys();
+        if (ret != -2) printf("\nPress any button to exit.");
     } else {
         /* HW_AHBPROT flag is enabled */
         printf("The HW_AHBPROT hardware register is not disabled.\n");
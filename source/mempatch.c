@@ -0,0 +1,96 @@
+#include <gccore.h>
+#include <string.h>
+
+#include "tools.h"
+#include "mempatch.h"
+
+static bool IsValidPatch(const mem_patch_t *patch)
+{
+    return (patch && patch->pattern && patch->pattern_size && patch->patch && patch->patch_size);
+}
+
+static bool IsPatchWithinRange(const mem_patch_t *patch, u32 addr, u32 start, u32 end)
+{
+    u32 patch_addr = (u32)((s32)addr + patch->patch_offset);
+    return (addr >= start && (addr + patch->pattern_size) <= end && patch_addr >= start && (patch_addr + patch->patch_size) <= end);
+}
+
+static void WritePatch(const mem_patch_t *patch, u32 addr)
+{
+    u32 patch_addr = (u32)((s32)addr + patch->patch_offset);
+
+    /* In order to properly patch the desired pattern, we must tweak both d-cache and L1 i-cache */
+    /* We must guarantee the addresses and sizes are aligned to a 32-byte boundary */
+    void *patch_addr_align = (void*)ALIGN_DOWN(patch_addr, 0x20);
+    u32 patch_size_align = (ALIGN_UP(patch_addr + patch->patch_size, 0x20) - ALIGN_DOWN(patch_addr, 0x20));
+
+    DCInvalidateRange(patch_addr_align, patch_size_align);
+    memcpy((void*)patch_addr, patch->patch, patch->patch_size);
+    DCFlushRange(patch_addr_align, patch_size_align);
+    ICInvalidateRange(patch_addr_align, patch_size_align);
+}
+
+u32 ApplyMemoryPatches(mem_patch_t *patches, u32 count, u32 start, u32 end)
+{
+    if (!patches || !count || count > MEMPATCH_MAX_ENTRIES || start >= end) return 0;
+
+    u32 first_byte_masks[0x100] = {0};
+    u32 pending_mask = 0, matched = 0;
+
+    /* Map each possible first byte to the set of patterns starting with it, so most addresses are rejected with a single table lookup */
+    for(u32 i = 0; i < count; i++)
+    {
+        mem_patch_t *patch = &(patches[i]);
+        patch->matches = patch->first_match = 0;
+
+        if (!IsValidPatch(patch)) continue;
+
+        first_byte_masks[patch->pattern[0]] |= (1U << i);
+        pending_mask |= (1U << i);
+    }
+
+    /* Look for all patterns at once. We stop early once every pattern that only needs to be patched once has been found, unless others still need a full sweep */
+    for(u32 addr = start; addr < end && pending_mask; addr++)
+    {
+        u32 mask = (first_byte_masks[*((u8*)addr)] & pending_mask);
+
+        while(mask)
+        {
+            u32 i = (31 - __builtin_clz(mask));
+            mask &= ~(1U << i);
+
+            mem_patch_t *patch = &(patches[i]);
+
+            /* Skip matches whose pattern or patch would exceed our memory extents */
+            if (!IsPatchWithinRange(patch, addr, start, end)) continue;
+
+            /* Check if we have found the pattern */
+            if (memcmp((u8*)addr, patch->pattern, patch->pattern_size) != 0) continue;
+
+            WritePatch(patch, addr);
+
+            if (!patch->matches++)
+            {
+                patch->first_match = addr;
+                matched++;
+            }
+
+            if (!patch->patch_all) pending_mask &= ~(1U << i);
+        }
+    }
+
+    return matched;
+}
+
+bool ApplyMemoryPatchAt(mem_patch_t *patch, u32 addr, u32 start, u32 end)
+{
+    if (!IsValidPatch(patch) || !IsPatchWithinRange(patch, addr, start, end)) return false;
+
+    if (memcmp((u8*)addr, patch->pattern, patch->pattern_size) != 0) return false;
+
+    WritePatch(patch, addr);
+
+    if (!patch->matches++) patch->first_match = addr;
+
+    return true;
+}
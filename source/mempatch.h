@@ -0,0 +1,29 @@
+#ifndef __MEMPATCH_H__
+#define __MEMPATCH_H__
+
+#include <gctypes.h>
+
+/* Maximum number of entries that can be passed to ApplyMemoryPatches() at once. */
+#define MEMPATCH_MAX_ENTRIES    32
+
+typedef struct {
+    const char *name;
+    const u8 *pattern;
+    u32 pattern_size;
+    const u8 *patch;
+    u32 patch_size;
+    s32 patch_offset;   // Relative to the start of each pattern match.
+    bool patch_all;     // Patch every match instead of just the first one.
+    u32 matches;        // Filled by ApplyMemoryPatches(): number of times this entry's pattern was found and patched.
+    u32 first_match;    // Filled by ApplyMemoryPatches(): address of the first match, if any.
+} mem_patch_t;
+
+/* Looks for every pattern from the provided table within [start, end) in a single pass, and applies the corresponding patches. */
+/* Each match is written back to memory as soon as it's patched. Returns the number of entries that matched at least once. */
+u32 ApplyMemoryPatches(mem_patch_t *patches, u32 count, u32 start, u32 end);
+
+/* Checks if the provided entry's pattern is located at the provided address with a single compare, and applies its patch if so. */
+/* Meant for known pattern locations (e.g. a specific IOS build), so the full scan can be skipped. Updates the entry's match fields on success. */
+bool ApplyMemoryPatchAt(mem_patch_t *patch, u32 addr, u32 start, u32 end);
+
+#endif /* __MEMPATCH_H__ */
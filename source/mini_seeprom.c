@@ -12,11 +12,12 @@ Copyright (C) 2020          Pablo Curiel "DarkMatterCore" <pabloacurielz@gmail.c
 # see http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
 */
 
-#include <ogc/machine/processor.h>
 #include <unistd.h>
 #include <string.h>
 
+#include "mmio.h"
 #include "mini_seeprom.h"
+#include "blockdev.h"
 
 #define HW_REG_BASE     0xd800000
 #define HW_GPIO1OUT     (HW_REG_BASE + 0x0e0)
@@ -25,7 +26,9 @@ Copyright (C) 2020          Pablo Curiel "DarkMatterCore" <pabloacurielz@gmail.c
 #define HW_SEEPROM_BLK_SIZE 2
 #define HW_SEEPROM_BLK_CNT  (SEEPROM_SIZE / HW_SEEPROM_BLK_SIZE)
 
-#define eeprom_delay()  usleep(5)
+#define eeprom_delay()  mmio_delay_ns(seeprom_half_period_ns)
+
+static u32 seeprom_half_period_ns = SEEPROM_DEFAULT_HALF_PERIOD_NS;
 
 enum {
     GP_EEP_CS = 0x000400,
@@ -42,17 +45,17 @@ static void seeprom_send_bits(u16 value, u8 bits)
     {
         if (value & (1 << bits))
         {
-            mask32(HW_GPIO1OUT, 0, GP_EEP_MOSI);
+            mmio_mask32(HW_GPIO1OUT, 0, GP_EEP_MOSI);
         } else {
-            mask32(HW_GPIO1OUT, GP_EEP_MOSI, 0);
+            mmio_mask32(HW_GPIO1OUT, GP_EEP_MOSI, 0);
         }
 
         eeprom_delay();
 
-        mask32(HW_GPIO1OUT, 0, GP_EEP_CLK);
+        mmio_mask32(HW_GPIO1OUT, 0, GP_EEP_CLK);
         eeprom_delay();
 
-        mask32(HW_GPIO1OUT, GP_EEP_CLK, 0);
+        mmio_mask32(HW_GPIO1OUT, GP_EEP_CLK, 0);
         eeprom_delay();
     }
 }
@@ -67,83 +70,124 @@ static u16 seeprom_recv_bits(u8 bits)
     {
         res <<= 1;
 
-        mask32(HW_GPIO1OUT, 0, GP_EEP_CLK);
+        mmio_mask32(HW_GPIO1OUT, 0, GP_EEP_CLK);
         eeprom_delay();
 
-        mask32(HW_GPIO1OUT, GP_EEP_CLK, 0);
+        mmio_mask32(HW_GPIO1OUT, GP_EEP_CLK, 0);
         eeprom_delay();
 
-        res |= !!(read32(HW_GPIO1IN) & GP_EEP_MISO);
+        res |= !!(mmio_read32(HW_GPIO1IN) & GP_EEP_MISO);
     }
 
     return (u16)res;
 }
 
-u16 seeprom_read(void *dst, u16 offset, u16 size)
-{
-    if (!dst || offset >= SEEPROM_SIZE || !size || (offset + size) > SEEPROM_SIZE) return 0;
+typedef struct {
+    bool active;    // A READ command cycle is in progress.
+    u32 next_block; // Word the SEEPROM is going to clock out next.
+} seeprom_burst_t;
 
-    u16 cur_offset = 0;
+static seeprom_burst_t seeprom_burst = {0};
 
-    u8 *ptr = (u8*)dst;
-    u8 val[HW_SEEPROM_BLK_SIZE] = {0};
+static void seeprom_end_burst(seeprom_burst_t *burst)
+{
+    if (!burst->active) return;
 
-    // Calculate block offsets and sizes
-    u8 start_addr = (u8)(offset / HW_SEEPROM_BLK_SIZE);
-    u8 start_addr_offset = (u8)(offset % HW_SEEPROM_BLK_SIZE);
+    // End of command cycle
+    mmio_mask32(HW_GPIO1OUT, GP_EEP_CS, 0);
+    eeprom_delay();
 
-    u8 end_addr = (u8)((offset + size) / HW_SEEPROM_BLK_SIZE);
-    u8 end_addr_size = (u8)((offset + size) % HW_SEEPROM_BLK_SIZE);
+    burst->active = false;
+}
 
-    if (!end_addr_size)
+static void seeprom_read_block(void *priv, u32 block, u8 *out)
+{
+    seeprom_burst_t *burst = (seeprom_burst_t*)priv;
+
+    // The SEEPROM keeps clocking out the following words for as long as CS stays asserted after a READ command, so we only need to
+    // issue a new command if the requested word isn't the next one in line
+    if (!burst->active || block != burst->next_block)
     {
-        end_addr--;
-        end_addr_size = HW_SEEPROM_BLK_SIZE;
+        seeprom_end_burst(burst);
+
+        // Start command cycle
+        mmio_mask32(HW_GPIO1OUT, 0, GP_EEP_CS);
+
+        // Send read command + address
+        seeprom_send_bits(0x600 | block, 11);
+
+        burst->active = true;
     }
 
-    if (end_addr == start_addr) end_addr_size -= start_addr_offset;
+    // Receive data
+    u16 val = seeprom_recv_bits(16);
+    BLOCKDEV_PUT_BE16(out, val);
+
+    burst->next_block = (block + 1);
+}
 
-    mask32(HW_GPIO1OUT, GP_EEP_CLK, 0);
-    mask32(HW_GPIO1OUT, GP_EEP_CS, 0);
+static const blockdev_t seeprom_dev = {
+    .block_size = HW_SEEPROM_BLK_SIZE,
+    .size = SEEPROM_SIZE,
+    .read_block = seeprom_read_block,
+    .priv = &seeprom_burst
+};
+
+u16 seeprom_read(void *dst, u16 offset, u16 size)
+{
+    if (!dst || offset >= SEEPROM_SIZE || !size || (offset + size) > SEEPROM_SIZE) return 0;
+
+    u16 ret = 0;
+
+    mmio_mask32(HW_GPIO1OUT, GP_EEP_CLK, 0);
+    mmio_mask32(HW_GPIO1OUT, GP_EEP_CS, 0);
     eeprom_delay();
 
-    for(u16 i = start_addr; i <= end_addr; i++)
-    {
-        if (cur_offset >= size) break;
+    // The whole range is read using a single command cycle
+    ret = (u16)blockdev_read(&seeprom_dev, dst, offset, size);
+    seeprom_end_burst(&seeprom_burst);
 
-        // Start command cycle
-        mask32(HW_GPIO1OUT, 0, GP_EEP_CS);
+    return ret;
+}
 
-        // Send read command + address
-        seeprom_send_bits(0x600 | i, 11);
+void seeprom_set_half_period(u32 ns)
+{
+    seeprom_half_period_ns = (ns ? ns : SEEPROM_DEFAULT_HALF_PERIOD_NS);
+}
 
-        // Receive data
-        *((u16*)val) = seeprom_recv_bits(16);
+u32 seeprom_get_half_period(void)
+{
+    return seeprom_half_period_ns;
+}
 
-        // End of command cycle
-        mask32(HW_GPIO1OUT, GP_EEP_CS, 0);
-        eeprom_delay();
+bool seeprom_check_known_fields(const void *data)
+{
+    // MS ID (0x00000002) followed by CA ID (0x00000001)
+    static const u8 ids[] = { 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x01 };
+    return (data && !memcmp(data, ids, sizeof(ids)));
+}
 
-        // Copy read data to destination buffer
-        if (i == start_addr && start_addr_offset != 0)
-        {
-            // Handle unaligned read at start address
-            memcpy(ptr + cur_offset, val + start_addr_offset, HW_SEEPROM_BLK_SIZE - start_addr_offset);
-            cur_offset += (HW_SEEPROM_BLK_SIZE - start_addr_offset);
-        } else
-        if (i == end_addr && end_addr_size != HW_SEEPROM_BLK_SIZE)
-        {
-            // Handle unaligned read at end address
-            memcpy(ptr + cur_offset, val, end_addr_size);
-            cur_offset += end_addr_size;
-        } else {
-            // Normal read
-            memcpy(ptr + cur_offset, val, HW_SEEPROM_BLK_SIZE);
-            cur_offset += HW_SEEPROM_BLK_SIZE;
-        }
+u32 seeprom_calibrate(u32 min_half_period_ns)
+{
+    static const u32 candidates[] = { 250, 500, SEEPROM_DEFAULT_HALF_PERIOD_NS, 2500 };
+
+    u8 ref[SEEPROM_SIZE] = {0}, buf[SEEPROM_SIZE] = {0};
+
+    seeprom_half_period_ns = SEEPROM_SAFE_HALF_PERIOD_NS;
+    if (seeprom_read(ref, 0, SEEPROM_SIZE) != SEEPROM_SIZE || !seeprom_check_known_fields(ref)) return 0;
+
+    /* Anything faster than a half-period that already failed would only be more marginal */
+    for(u32 i = 0; i < (sizeof(candidates) / sizeof(candidates[0])); i++)
+    {
+        if (candidates[i] < min_half_period_ns) continue;
+
+        seeprom_half_period_ns = candidates[i];
+        if (seeprom_read(buf, 0, SEEPROM_SIZE) == SEEPROM_SIZE && !memcmp(buf, ref, SEEPROM_SIZE)) return seeprom_half_period_ns;
     }
 
-    return cur_offset;
+    seeprom_half_period_ns = SEEPROM_SAFE_HALF_PERIOD_NS;
+
+    return seeprom_half_period_ns;
 }
 
 u16 seeprom_write(const void *src, u16 offset, u16 size)
@@ -174,14 +218,14 @@ u16 seeprom_write(const void *src, u16 offset, u16 size)
     // Disable CPU interruptions
     _CPU_ISR_Disable(level);
 
-    mask32(HW_GPIO1OUT, GP_EEP_CLK, 0);
-    mask32(HW_GPIO1OUT, GP_EEP_CS, 0);
+    mmio_mask32(HW_GPIO1OUT, GP_EEP_CLK, 0);
+    mmio_mask32(HW_GPIO1OUT, GP_EEP_CS, 0);
     eeprom_delay();
 
     // EWEN - Enable programming commands
-    mask32(HW_GPIO1OUT, 0, GP_EEP_CS);
+    mmio_mask32(HW_GPIO1OUT, 0, GP_EEP_CS);
     seeprom_send_bits(0x4FF, 11);
-    mask32(HW_GPIO1OUT, GP_EEP_CS, 0);
+    mmio_mask32(HW_GPIO1OUT, GP_EEP_CS, 0);
     eeprom_delay();
 
     for(u16 i = start_addr; i <= end_addr; i++)
@@ -194,16 +238,17 @@ u16 seeprom_write(const void *src, u16 offset, u16 size)
             // Read data from SEEPROM to handle unaligned writes
 
             // Start command cycle
-            mask32(HW_GPIO1OUT, 0, GP_EEP_CS);
+            mmio_mask32(HW_GPIO1OUT, 0, GP_EEP_CS);
 
             // Send read command + address
             seeprom_send_bits(0x600 | i, 11);
 
             // Receive data
-            *((u16*)val) = seeprom_recv_bits(16);
+            u16 cur_val = seeprom_recv_bits(16);
+            BLOCKDEV_PUT_BE16(val, cur_val);
 
             // End of command cycle
-            mask32(HW_GPIO1OUT, GP_EEP_CS, 0);
+            mmio_mask32(HW_GPIO1OUT, GP_EEP_CS, 0);
             eeprom_delay();
 
             if (i == start_addr && start_addr_offset != 0)
@@ -223,33 +268,33 @@ u16 seeprom_write(const void *src, u16 offset, u16 size)
         }
 
         // Start command cycle
-        mask32(HW_GPIO1OUT, 0, GP_EEP_CS);
+        mmio_mask32(HW_GPIO1OUT, 0, GP_EEP_CS);
 
         // Send write command + address
         seeprom_send_bits(0x500 | i, 11);
 
         // Send data
-        seeprom_send_bits(*((u16*)val), 16);
+        seeprom_send_bits(((u16)val[0] << 8) | val[1], 16);
 
         // End of command cycle
-        mask32(HW_GPIO1OUT, GP_EEP_CS, 0);
+        mmio_mask32(HW_GPIO1OUT, GP_EEP_CS, 0);
         eeprom_delay();
 
         // Wait until SEEPROM is ready (write cycle is self-timed so no clocking needed)
-        mask32(HW_GPIO1OUT, 0, GP_EEP_CS);
+        mmio_mask32(HW_GPIO1OUT, 0, GP_EEP_CS);
 
         do {
             eeprom_delay();
-        } while(!(read32(HW_GPIO1IN) & GP_EEP_MISO));
+        } while(!(mmio_read32(HW_GPIO1IN) & GP_EEP_MISO));
 
-        mask32(HW_GPIO1OUT, GP_EEP_CS, 0);
+        mmio_mask32(HW_GPIO1OUT, GP_EEP_CS, 0);
         eeprom_delay();
     }
 
     // EWDS - Disable programming commands
-    mask32(HW_GPIO1OUT, 0, GP_EEP_CS);
+    mmio_mask32(HW_GPIO1OUT, 0, GP_EEP_CS);
     seeprom_send_bits(0x400, 11);
-    mask32(HW_GPIO1OUT, GP_EEP_CS, 0);
+    mmio_mask32(HW_GPIO1OUT, GP_EEP_CS, 0);
     eeprom_delay();
 
     // Enable CPU interruptions
@@ -52,6 +52,23 @@ typedef struct
     u8 pad2[4];
 } seeprom_t;
 
+/* Clock half-period used to bit-bang the SEEPROM. The default one is about twice as long as what the slowest 93C56 parts need at 2.7 V, */
+/* while the safe one matches the usleep(5) MINI used to rely on. */
+#define SEEPROM_DEFAULT_HALF_PERIOD_NS  1000
+#define SEEPROM_SAFE_HALF_PERIOD_NS     5000
+
+void seeprom_set_half_period(u32 ns);
+u32 seeprom_get_half_period(void);
+
+/* Checks the fields every SEEPROM is known to hold (MS and CA IDs) within the provided dump. */
+bool seeprom_check_known_fields(const void *data);
+
+/* Reads the whole SEEPROM using the safe half-period and checks its known fields (MS and CA IDs). Then picks the shortest half-period */
+/* that's at least min_half_period_ns long (e.g. the one that just failed) and reads back the exact same data. Candidates are tried in */
+/* ascending order. Returns the selected half-period, or 0 if the SEEPROM couldn't be validated at all, in which case the safe half-period */
+/* is kept. */
+u32 seeprom_calibrate(u32 min_half_period_ns);
+
 u16 seeprom_read(void *dst, u16 offset, u16 size);
 u16 seeprom_write(const void *src, u16 offset, u16 size);
 
@@ -0,0 +1,79 @@
+#ifndef __MMIO_H__
+#define __MMIO_H__
+
+#include <gctypes.h>
+
+#define HW_SRNPROT                  0xD800060
+
+/* Hardware readers go through these accessors instead of using libogc's directly. Regular builds map them straight to read32() / write32() / mask32(). */
+/* The AES and SHA engine drivers use them as well. Building with XYZZY_HOST_MMIO defined replaces them with a simulated Hollywood register file */
+/* (see mmio_host.c), so the readers and drivers can run on a host machine for regression tests and to count the register accesses made by each */
+/* dump path. "make host-mmio-test" runs those tests (host/mmio_test.c). */
+
+#ifndef XYZZY_HOST_MMIO
+
+#include <ogc/machine/processor.h>
+#include <ogc/lwp_watchdog.h>
+#include <ogc/system.h>
+
+#define mmio_read32(addr)               read32(addr)
+#define mmio_write32(addr, val)         write32(addr, val)
+#define mmio_mask32(addr, clear, set)   mask32(addr, clear, set)
+
+/* Physical address to program into a DMA source / destination register for the provided buffer */
+#define mmio_dma_address(ptr)           ((u32)MEM_VIRTUAL_TO_PHYSICAL(ptr))
+
+/* Busy-waits on the PPC timebase. Meant for bit-banging, where going through the scheduler would oversleep by orders of magnitude. */
+static inline void mmio_delay_ns(u32 ns)
+{
+    u64 start = gettime(), ticks = nanosecs_to_ticks(ns);
+    while(diff_ticks(start, gettime()) < ticks);
+}
+
+#else   /* XYZZY_HOST_MMIO */
+
+/* Nothing can preempt the simulator, so there are no interrupts to disable */
+#define _CPU_ISR_Disable(level)         ((level) = 0)
+#define _CPU_ISR_Restore(level)         ((void)(level))
+
+typedef struct {
+    u32 reads;              // Total register reads.
+    u32 writes;             // Total register writes (a mask counts as one read and one write).
+    u32 otp_commands;       // Words requested through HW_OTP_COMMAND.
+    u32 sram_reads;         // Reads from the SRAM mirror, including boot0.
+    u32 seeprom_clocks;     // SEEPROM clock pulses while CS was asserted.
+    u32 seeprom_commands;   // SEEPROM commands decoded.
+    u32 aes_commands;       // AES engine commands executed, including failed ones.
+    u32 aes_blocks;         // 16-byte blocks requested from the AES engine.
+    u32 sha_commands;       // SHA engine commands executed, including failed ones.
+    u32 sha_blocks;         // 64-byte blocks requested from the SHA engine.
+    u64 delay_ns;           // Time spent in mmio_delay_ns(). Delays aren't actually waited for, so this is the simulated duration.
+} mmio_host_stats_t;
+
+u32 mmio_read32(u32 addr);
+void mmio_write32(u32 addr, u32 val);
+void mmio_mask32(u32 addr, u32 clear, u32 set);
+void mmio_delay_ns(u32 ns);
+
+/* Host pointers don't fit in a DMA register, so each buffer handed to the simulated AES / SHA engines gets its own window of simulated */
+/* physical address space. Windows are recycled in a round-robin fashion, so the returned address must be written to the engine right away. */
+u32 mmio_dma_address(const void *ptr);
+
+/* Puts every simulated device back in its power-on state and clears the access counters. Device contents are kept. */
+void mmio_host_reset(void);
+
+/* Loads simulated device contents. Each one takes a byte image laid out exactly like a dump made on a console. */
+void mmio_host_load_otp(const void *data, u32 size);
+void mmio_host_load_seeprom(const void *data, u32 size);
+void mmio_host_load_boot0(const void *data, u32 size);
+void mmio_host_load_sram(u32 offset, const void *data, u32 size);
+
+/* Makes every following AES / SHA engine command fail with the error bit set, until called again with false. */
+void mmio_host_fail_engines(bool fail);
+
+void mmio_host_get_stats(mmio_host_stats_t *out);
+void mmio_host_reset_stats(void);
+
+#endif  /* XYZZY_HOST_MMIO */
+
+#endif /* __MMIO_H__ */
@@ -0,0 +1,572 @@
+#ifdef XYZZY_HOST_MMIO
+
+#include <string.h>
+
+#include "mmio.h"
+#include "aes_internal.h"
+
+/* Simulated Hollywood register file. Only the registers used by the OTP, SEEPROM, boot0 and vWii SRAM OTP readers, as well as the AES and SHA */
+/* engine drivers, are modeled. The AES engine model relies on the software block cipher from aes.c. Only the CBC chaining, DMA and register */
+/* handling is its own. */
+
+#define HW_OTP_COMMAND      0xD8001EC
+#define HW_OTP_DATA         0xD8001F0
+#define HW_BOOT0            0xD80018C
+#define HW_GPIO1OUT         0xD8000E0
+#define HW_GPIO1IN          0xD8000E8
+#define HW_AHBPROT          0xD800064
+
+#define SRAM_MIRROR         0xD400000
+#define SRAM_SIZE           0x10000
+#define SRAM_MASK           0x20
+
+#define BOOT0_MAX_SIZE      0x4000
+#define BOOT0_MASK          0x1000
+
+#define OTP_BANK_SIZE       0x80
+
+#define GP_EEP_CS           0x000400
+#define GP_EEP_CLK          0x000800
+#define GP_EEP_MOSI         0x001000
+#define GP_EEP_MISO         0x002000
+
+#define HW_AES_CTRL         0xD020000
+#define HW_AES_SRC          0xD020004
+#define HW_AES_DEST         0xD020008
+#define HW_AES_KEY          0xD02000C
+#define HW_AES_IV           0xD020010
+
+#define HW_SHA_CTRL         0xD030000
+#define HW_SHA_SRC          0xD030004
+#define HW_SHA_H0           0xD030008
+
+#define ENGINE_CTRL_EXEC    0x80000000
+#define ENGINE_CTRL_ERR     0x20000000
+
+#define AES_CTRL_ENA        0x10000000
+#define AES_CTRL_DEC        0x08000000
+#define AES_CTRL_CHAIN      0x00001000
+#define AES_CTRL_BLOCKS     0x00000FFF
+#define AES_BLK_SIZE        16
+#define AES_ROUND_KEYS      44
+
+#define SHA_CTRL_BLOCKS     0x000003FF
+#define SHA_BLK_SIZE        64
+#define SHA_STATE_WORDS     5
+
+/* Simulated physical address space handed out by mmio_dma_address(). Starts where MEM2 does. */
+#define DMA_PHYS_BASE       0x10000000
+#define DMA_WINDOW_SIZE     0x1000000
+#define DMA_WINDOWS         16
+
+/* 93C56 in x16 organization: 128 words, 11-bit commands (start bit, 2-bit opcode, 8-bit address, the MSB of which is ignored) */
+#define SEEPROM_WORDS       0x80
+#define SEEPROM_CMD_BITS    11
+
+typedef enum {
+    SEEPROM_STATE_IDLE = 0,     // CS deasserted.
+    SEEPROM_STATE_COMMAND,      // Shifting in a command.
+    SEEPROM_STATE_READ,         // Shifting out data. Keeps going through the following words for as long as CS stays asserted.
+    SEEPROM_STATE_WRITE_DATA,   // Shifting in a data word for a WRITE command.
+    SEEPROM_STATE_DONE          // Command complete, ignoring clocks until CS is deasserted.
+} seeprom_state_t;
+
+static u8 otp[OTP_BANK_SIZE] = {0};
+static u8 sram[SRAM_SIZE] = {0};
+static u8 boot0[BOOT0_MAX_SIZE] = {0};
+static u16 seeprom[SEEPROM_WORDS] = {0};
+
+static u32 otp_command = 0, srnprot = 0, boot0_ctrl = 0, gpio1out = 0;
+
+static seeprom_state_t seeprom_state = SEEPROM_STATE_IDLE;
+static u32 seeprom_shift = 0, seeprom_bits = 0;
+static u8 seeprom_addr = 0;
+static bool seeprom_miso = true, seeprom_write_enabled = false;
+
+static u32 ahbprot = 0;
+
+static u32 aes_ctrl = 0, aes_src = 0, aes_dest = 0;
+static u8 aes_key[AES_BLK_SIZE] = {0}, aes_iv[AES_BLK_SIZE] = {0}, aes_chain[AES_BLK_SIZE] = {0};
+
+static u32 sha_ctrl = 0, sha_src = 0, sha_state[SHA_STATE_WORDS] = {0};
+
+static bool engines_fail = false;
+
+static const void *dma_windows[DMA_WINDOWS] = {0};
+static u32 dma_next_window = 0;
+
+static mmio_host_stats_t stats = {0};
+
+static u32 GetBE32(const u8 *p)
+{
+    return (((u32)p[0] << 24) | ((u32)p[1] << 16) | ((u32)p[2] << 8) | (u32)p[3]);
+}
+
+static void PutBE32(u8 *p, u32 val)
+{
+    p[0] = (u8)(val >> 24);
+    p[1] = (u8)(val >> 16);
+    p[2] = (u8)(val >> 8);
+    p[3] = (u8)val;
+}
+
+static u8 *DmaTranslate(u32 addr, u32 size)
+{
+    if (addr < DMA_PHYS_BASE) return NULL;
+
+    u32 window = ((addr - DMA_PHYS_BASE) / DMA_WINDOW_SIZE), offset = ((addr - DMA_PHYS_BASE) % DMA_WINDOW_SIZE);
+    if (window >= DMA_WINDOWS || !dma_windows[window] || size > (DMA_WINDOW_SIZE - offset)) return NULL;
+
+    return ((u8*)(uintptr_t)dma_windows[window] + offset);
+}
+
+/* Key and IV registers are FIFOs: each write pushes a big endian word, and the last four writes make up the current value */
+static void PushFifo(u8 *fifo, u32 val)
+{
+    memmove(fifo, fifo + 4, AES_BLK_SIZE - 4);
+    PutBE32(fifo + AES_BLK_SIZE - 4, val);
+}
+
+static void AesExecute(u32 ctrl)
+{
+    u32 blocks = ((ctrl & AES_CTRL_BLOCKS) + 1), size = (blocks * AES_BLK_SIZE), rk[AES_ROUND_KEYS] = {0};
+    u8 *src = DmaTranslate(aes_src, size), *dst = DmaTranslate(aes_dest, size), block[AES_BLK_SIZE] = {0};
+
+    stats.aes_commands++;
+    stats.aes_blocks += blocks;
+
+    if (engines_fail || !src || !dst)
+    {
+        aes_ctrl = ((ctrl & ~ENGINE_CTRL_EXEC) | ENGINE_CTRL_ERR);
+        return;
+    }
+
+    // Chained commands pick up where the previous one left off, everything else starts from the IV FIFO
+    if (!(ctrl & AES_CTRL_CHAIN)) memcpy(aes_chain, aes_iv, AES_BLK_SIZE);
+
+    if (!(ctrl & AES_CTRL_ENA))
+    {
+        // Plain DMA copy
+        memmove(dst, src, size);
+    } else
+    if (!(ctrl & AES_CTRL_DEC))
+    {
+        rijndaelKeySetupEnc(rk, aes_key);
+
+        for(u32 i = 0; i < size; i += AES_BLK_SIZE)
+        {
+            for(u32 j = 0; j < AES_BLK_SIZE; j++) block[j] = (src[i + j] ^ aes_chain[j]);
+            rijndaelEncrypt(rk, block, dst + i);
+            memcpy(aes_chain, dst + i, AES_BLK_SIZE);
+        }
+    } else {
+        rijndaelKeySetupDec(rk, aes_key);
+
+        for(u32 i = 0; i < size; i += AES_BLK_SIZE)
+        {
+            // The input block is gone once it's been decrypted in place, so hold on to it for the next one
+            u8 next_chain[AES_BLK_SIZE] = {0};
+            memcpy(next_chain, src + i, AES_BLK_SIZE);
+
+            rijndaelDecrypt(rk, src + i, block);
+            for(u32 j = 0; j < AES_BLK_SIZE; j++) dst[i + j] = (block[j] ^ aes_chain[j]);
+
+            memcpy(aes_chain, next_chain, AES_BLK_SIZE);
+        }
+    }
+
+    aes_src += size;
+    aes_dest += size;
+    aes_ctrl = (ctrl & ~ENGINE_CTRL_EXEC);
+}
+
+/* Plain FIPS 180 SHA-1 compression function, kept independent from sha1.c on purpose */
+static void ShaCompress(u32 *state, const u8 *block)
+{
+    u32 w[80] = {0}, a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+
+    for(u32 i = 0; i < 16; i++) w[i] = GetBE32(block + (i * 4));
+    for(u32 i = 16; i < 80; i++)
+    {
+        u32 x = (w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16]);
+        w[i] = ((x << 1) | (x >> 31));
+    }
+
+    for(u32 i = 0; i < 80; i++)
+    {
+        u32 f = 0, k = 0;
+
+        if (i < 20)
+        {
+            f = ((b & c) | (~b & d));
+            k = 0x5A827999;
+        } else
+        if (i < 40)
+        {
+            f = (b ^ c ^ d);
+            k = 0x6ED9EBA1;
+        } else
+        if (i < 60)
+        {
+            f = ((b & c) | (b & d) | (c & d));
+            k = 0x8F1BBCDC;
+        } else {
+            f = (b ^ c ^ d);
+            k = 0xCA62C1D6;
+        }
+
+        u32 tmp = (((a << 5) | (a >> 27)) + f + e + k + w[i]);
+        e = d;
+        d = c;
+        c = ((b << 30) | (b >> 2));
+        b = a;
+        a = tmp;
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+}
+
+static void ShaExecute(u32 ctrl)
+{
+    u32 blocks = ((ctrl & SHA_CTRL_BLOCKS) + 1), size = (blocks * SHA_BLK_SIZE);
+    u8 *src = DmaTranslate(sha_src, size);
+
+    stats.sha_commands++;
+    stats.sha_blocks += blocks;
+
+    if (engines_fail || !src)
+    {
+        sha_ctrl = ((ctrl & ~ENGINE_CTRL_EXEC) | ENGINE_CTRL_ERR);
+        return;
+    }
+
+    for(u32 i = 0; i < size; i += SHA_BLK_SIZE) ShaCompress(sha_state, src + i);
+
+    sha_src += size;
+    sha_ctrl = (ctrl & ~ENGINE_CTRL_EXEC);
+}
+
+static void SeepromExecuteCommand(void)
+{
+    u32 opcode = ((seeprom_shift >> 8) & 3);
+
+    seeprom_addr = (seeprom_shift & (SEEPROM_WORDS - 1));
+    seeprom_state = SEEPROM_STATE_DONE;
+    stats.seeprom_commands++;
+
+    switch(opcode)
+    {
+        case 2:
+            // READ: a dummy zero bit is output right after the address, then data follows on every rising clock edge
+            seeprom_state = SEEPROM_STATE_READ;
+            seeprom_shift = seeprom[seeprom_addr];
+            seeprom_bits = 0;
+            seeprom_miso = false;
+            break;
+        case 1:
+            // WRITE
+            seeprom_state = SEEPROM_STATE_WRITE_DATA;
+            seeprom_shift = 0;
+            seeprom_bits = 0;
+            break;
+        case 3:
+            // ERASE
+            if (seeprom_write_enabled) seeprom[seeprom_addr] = 0xFFFF;
+            break;
+        default:
+            // EWEN / EWDS (ERAL and WRAL aren't used by us)
+            if (((seeprom_shift >> 6) & 3) == 3) seeprom_write_enabled = true;
+            if (((seeprom_shift >> 6) & 3) == 0) seeprom_write_enabled = false;
+            break;
+    }
+}
+
+static void SeepromClock(bool mosi)
+{
+    stats.seeprom_clocks++;
+
+    switch(seeprom_state)
+    {
+        case SEEPROM_STATE_COMMAND:
+            // Leading zeroes are ignored until the start bit shows up
+            if (!seeprom_bits && !mosi) break;
+
+            seeprom_shift = ((seeprom_shift << 1) | (mosi ? 1 : 0));
+            if (++seeprom_bits == SEEPROM_CMD_BITS) SeepromExecuteCommand();
+
+            break;
+        case SEEPROM_STATE_READ:
+            if (seeprom_bits == 16)
+            {
+                // Sequential read: move on to the next word
+                seeprom_addr = ((seeprom_addr + 1) & (SEEPROM_WORDS - 1));
+                seeprom_shift = seeprom[seeprom_addr];
+                seeprom_bits = 0;
+            }
+
+            seeprom_miso = ((seeprom_shift >> (15 - seeprom_bits)) & 1);
+            seeprom_bits++;
+
+            break;
+        case SEEPROM_STATE_WRITE_DATA:
+            seeprom_shift = ((seeprom_shift << 1) | (mosi ? 1 : 0));
+            if (++seeprom_bits < 16) break;
+
+            // Programming is instantaneous, so the part reports itself as ready right away
+            if (seeprom_write_enabled) seeprom[seeprom_addr] = (u16)seeprom_shift;
+            seeprom_state = SEEPROM_STATE_DONE;
+
+            break;
+        default:
+            break;
+    }
+}
+
+static void SeepromUpdatePins(u32 old_out, u32 new_out)
+{
+    bool cs = (new_out & GP_EEP_CS), old_cs = (old_out & GP_EEP_CS);
+
+    if (!cs)
+    {
+        seeprom_state = SEEPROM_STATE_IDLE;
+        seeprom_miso = true;
+        return;
+    }
+
+    // Rising CS edge starts a new command
+    if (!old_cs)
+    {
+        seeprom_state = SEEPROM_STATE_COMMAND;
+        seeprom_shift = 0;
+        seeprom_bits = 0;
+        seeprom_miso = true;
+        return;
+    }
+
+    // Data is latched on rising clock edges
+    if ((new_out & GP_EEP_CLK) && !(old_out & GP_EEP_CLK)) SeepromClock(new_out & GP_EEP_MOSI);
+}
+
+static u32 ReadSramMirror(u32 offset)
+{
+    stats.sram_reads++;
+
+    // Open bus if the mirror is disabled
+    if (!(srnprot & SRAM_MASK)) return 0;
+
+    // boot0 shows up at the start of the mirror while it isn't hidden
+    if (!(boot0_ctrl & BOOT0_MASK) && offset < BOOT0_MAX_SIZE) return GetBE32(boot0 + offset);
+
+    return GetBE32(sram + offset);
+}
+
+u32 mmio_read32(u32 addr)
+{
+    stats.reads++;
+
+    if (addr >= SRAM_MIRROR && addr < (SRAM_MIRROR + SRAM_SIZE)) return ReadSramMirror((addr - SRAM_MIRROR) & ~3);
+
+    if (addr >= HW_SHA_H0 && addr < (HW_SHA_H0 + (SHA_STATE_WORDS * 4))) return sha_state[(addr - HW_SHA_H0) / 4];
+
+    switch(addr)
+    {
+        case HW_OTP_COMMAND:
+            return otp_command;
+        case HW_OTP_DATA:
+            if (!(otp_command & 0x80000000)) return 0;
+            return GetBE32(otp + ((otp_command & 0x1F) * 4));
+        case HW_SRNPROT:
+            return srnprot;
+        case HW_BOOT0:
+            return boot0_ctrl;
+        case HW_GPIO1OUT:
+            return gpio1out;
+        case HW_GPIO1IN:
+            return (seeprom_miso ? GP_EEP_MISO : 0);
+        case HW_AHBPROT:
+            return ahbprot;
+        case HW_AES_CTRL:
+            return aes_ctrl;
+        case HW_AES_SRC:
+            return aes_src;
+        case HW_AES_DEST:
+            return aes_dest;
+        case HW_SHA_CTRL:
+            return sha_ctrl;
+        case HW_SHA_SRC:
+            return sha_src;
+        default:
+            break;
+    }
+
+    return 0;
+}
+
+void mmio_write32(u32 addr, u32 val)
+{
+    stats.writes++;
+
+    if (addr >= HW_SHA_H0 && addr < (HW_SHA_H0 + (SHA_STATE_WORDS * 4)))
+    {
+        sha_state[(addr - HW_SHA_H0) / 4] = val;
+        return;
+    }
+
+    switch(addr)
+    {
+        case HW_OTP_COMMAND:
+            otp_command = val;
+            if (val & 0x80000000) stats.otp_commands++;
+            break;
+        case HW_SRNPROT:
+            srnprot = val;
+            break;
+        case HW_BOOT0:
+            boot0_ctrl = val;
+            break;
+        case HW_GPIO1OUT:
+        {
+            u32 old_out = gpio1out;
+            gpio1out = val;
+            SeepromUpdatePins(old_out, val);
+            break;
+        }
+        case HW_AHBPROT:
+            ahbprot = val;
+            break;
+        case HW_AES_CTRL:
+            // Commands complete right away, so the busy bit is never seen set. Writing zero resets the engine.
+            if (val & ENGINE_CTRL_EXEC)
+            {
+                AesExecute(val);
+            } else {
+                aes_ctrl = val;
+            }
+            break;
+        case HW_AES_SRC:
+            aes_src = val;
+            break;
+        case HW_AES_DEST:
+            aes_dest = val;
+            break;
+        case HW_AES_KEY:
+            PushFifo(aes_key, val);
+            break;
+        case HW_AES_IV:
+            PushFifo(aes_iv, val);
+            break;
+        case HW_SHA_CTRL:
+            if (val & ENGINE_CTRL_EXEC)
+            {
+                ShaExecute(val);
+            } else {
+                sha_ctrl = val;
+            }
+            break;
+        case HW_SHA_SRC:
+            sha_src = val;
+            break;
+        default:
+            break;
+    }
+}
+
+void mmio_mask32(u32 addr, u32 clear, u32 set)
+{
+    mmio_write32(addr, (mmio_read32(addr) & ~clear) | set);
+}
+
+void mmio_delay_ns(u32 ns)
+{
+    stats.delay_ns += ns;
+}
+
+u32 mmio_dma_address(const void *ptr)
+{
+    if (!ptr) return 0;
+
+    u32 window = dma_next_window;
+    dma_next_window = ((dma_next_window + 1) % DMA_WINDOWS);
+
+    dma_windows[window] = ptr;
+
+    return (DMA_PHYS_BASE + (window * DMA_WINDOW_SIZE));
+}
+
+void mmio_host_reset(void)
+{
+    /* SRAM mirror enabled, boot0 hidden and HW_AHBPROT disabled, which is what IOS leaves behind for us */
+    otp_command = 0;
+    srnprot = SRAM_MASK;
+    boot0_ctrl = BOOT0_MASK;
+    gpio1out = 0;
+    ahbprot = 0xFFFFFFFF;
+
+    aes_ctrl = aes_src = aes_dest = 0;
+    memset(aes_key, 0, sizeof(aes_key));
+    memset(aes_iv, 0, sizeof(aes_iv));
+    memset(aes_chain, 0, sizeof(aes_chain));
+
+    sha_ctrl = sha_src = 0;
+    memset(sha_state, 0, sizeof(sha_state));
+
+    engines_fail = false;
+
+    memset(dma_windows, 0, sizeof(dma_windows));
+    dma_next_window = 0;
+
+    seeprom_state = SEEPROM_STATE_IDLE;
+    seeprom_shift = seeprom_bits = 0;
+    seeprom_addr = 0;
+    seeprom_miso = true;
+    seeprom_write_enabled = false;
+
+    mmio_host_reset_stats();
+}
+
+void mmio_host_load_otp(const void *data, u32 size)
+{
+    if (!data) return;
+    memcpy(otp, data, size < OTP_BANK_SIZE ? size : OTP_BANK_SIZE);
+}
+
+void mmio_host_load_seeprom(const void *data, u32 size)
+{
+    if (!data) return;
+
+    const u8 *ptr = (const u8*)data;
+    for(u32 i = 0; i < SEEPROM_WORDS && ((i * 2) + 1) < size; i++) seeprom[i] = (((u16)ptr[i * 2] << 8) | ptr[(i * 2) + 1]);
+}
+
+void mmio_host_load_boot0(const void *data, u32 size)
+{
+    if (!data) return;
+    memcpy(boot0, data, size < BOOT0_MAX_SIZE ? size : BOOT0_MAX_SIZE);
+}
+
+void mmio_host_load_sram(u32 offset, const void *data, u32 size)
+{
+    if (!data || offset >= SRAM_SIZE) return;
+    memcpy(sram + offset, data, (SRAM_SIZE - offset) < size ? (SRAM_SIZE - offset) : size);
+}
+
+void mmio_host_fail_engines(bool fail)
+{
+    engines_fail = fail;
+}
+
+void mmio_host_get_stats(mmio_host_stats_t *out)
+{
+    if (out) memcpy(out, &stats, sizeof(stats));
+}
+
+void mmio_host_reset_stats(void)
+{
+    memset(&stats, 0, sizeof(stats));
+}
+
+#endif /* XYZZY_HOST_MMIO */
@@ -29,16 +29,52 @@
  *
  */
 
+#include <string.h>
+
 #include "sha1.h"
+#include "sha_hw.h"
 
 /*
  *  Define the SHA1 circular left shift macro
  */
 #define SHA1CircularShift(bits, word)	(((word) << (bits)) | ((word) >> (32-(bits))))
 
+/*
+ *  Round functions and message schedule. W[] only holds the last 16
+ *  words of the schedule, and the five working variables are rotated
+ *  through the round macros instead of being shuffled around.
+ */
+#define SHA1F0(b, c, d)		((d) ^ ((b) & ((c) ^ (d))))
+#define SHA1F1(b, c, d)		((b) ^ (c) ^ (d))
+#define SHA1F2(b, c, d)		(((b) & (c)) | ((d) & ((b) | (c))))
+
+#define SHA1Schedule(t)		(W[(t) & 15] = SHA1CircularShift(1, W[((t) + 13) & 15] ^ W[((t) + 8) & 15] ^ W[((t) + 2) & 15] ^ W[(t) & 15]))
+
+#define SHA1Round(a, b, c, d, e, f, k, w) \
+	do { \
+		(e) += SHA1CircularShift(5, (a)) + f((b), (c), (d)) + (k) + (w); \
+		(b) = SHA1CircularShift(30, (b)); \
+	} while(0)
+
+#define R0(a, b, c, d, e, t)	SHA1Round(a, b, c, d, e, SHA1F0, 0x5A827999, W[t])
+#define R1(a, b, c, d, e, t)	SHA1Round(a, b, c, d, e, SHA1F0, 0x5A827999, SHA1Schedule(t))
+#define R2(a, b, c, d, e, t)	SHA1Round(a, b, c, d, e, SHA1F1, 0x6ED9EBA1, SHA1Schedule(t))
+#define R3(a, b, c, d, e, t)	SHA1Round(a, b, c, d, e, SHA1F2, 0x8F1BBCDC, SHA1Schedule(t))
+#define R4(a, b, c, d, e, t)	SHA1Round(a, b, c, d, e, SHA1F1, 0xCA62C1D6, SHA1Schedule(t))
+
+/* Five rounds starting at t, after which the working variables are back in their original places */
+#define SHA1Rounds5(R, t) \
+	do { \
+		R(A, B, C, D, E, (t)); \
+		R(E, A, B, C, D, (t) + 1); \
+		R(D, E, A, B, C, (t) + 2); \
+		R(C, D, E, A, B, (t) + 3); \
+		R(B, C, D, E, A, (t) + 4); \
+	} while(0)
+
 /* Local Function Prototyptes */
 void SHA1PadMessage(SHA1Context *context);
-void SHA1ProcessMessageBlock(SHA1Context *context);
+static void SHA1ProcessBlock(uint32_t *Intermediate_Hash, const uint8_t *block);
 
 /*
  *  SHA1Reset
@@ -121,6 +157,7 @@ int SHA1Result(SHA1Context *context, uint8_t Message_Digest[SHA1HashSize])
 	return shaSuccess;
 }
 
+
 /*
  *  SHA1Input
  *
@@ -140,9 +177,16 @@ int SHA1Result(SHA1Context *context, uint8_t Message_Digest[SHA1HashSize])
  *  Returns:
  *      sha Error Code.
  *
+ *  Comments:
+ *      Whole blocks are hashed straight from message_array. Only a
+ *      leading block started by a previous call and the trailing
+ *      partial block go through Message_Block.
+ *
  */
 int SHA1Input(SHA1Context *context, uint8_t *message_array, unsigned length)
 {
+	unsigned int size;
+
 	if (!length) return shaSuccess;
 
 	if (!context || !message_array) return shaNull;
@@ -155,128 +199,145 @@ int SHA1Input(SHA1Context *context, uint8_t *message_array, unsigned length)
 
 	if (context->Corrupted) return context->Corrupted;
 
-	while(length-- && !context->Corrupted)
+	/*
+	*  Update the message length in one go
+	*/
+	context->Length_Low += (length << 3);
+	if (context->Length_Low < (length << 3)) context->Length_High++;
+	context->Length_High += (length >> 29);
+	if (context->Length_High < (length >> 29))
+	{
+		/* Message is too long */
+		context->Corrupted = 1;
+		return shaSuccess;
+	}
+
+	/*
+	*  Complete the block left over by a previous call, if there's one
+	*/
+	if (context->Message_Block_Index)
 	{
-		context->Message_Block[context->Message_Block_Index++] = (*message_array & 0xFF);
+		size = (64 - context->Message_Block_Index);
+		if (size > length) size = length;
 		
-		context->Length_Low += 8;
-		if (context->Length_Low == 0)
-		{
-			context->Length_High++;
-			if (context->Length_High == 0)
-			{
-				/* Message is too long */
-				context->Corrupted = 1;
-			}
-		}
+		memcpy(context->Message_Block + context->Message_Block_Index, message_array, size);
+		context->Message_Block_Index += size;
+		message_array += size;
+		length -= size;
 		
-		if (context->Message_Block_Index == 64) SHA1ProcessMessageBlock(context);
+		if (context->Message_Block_Index < 64) return shaSuccess;
 		
-		message_array++;
+		SHA1ProcessBlock(context->Intermediate_Hash, context->Message_Block);
+		context->Message_Block_Index = 0;
 	}
-	
+
+	/*
+	*  Hand whole blocks over to the hardware SHA engine if the input is
+	*  large enough to be worth the DMA setup. Anything left over goes
+	*  through the software path below.
+	*/
+	if (length >= SHA_HW_MIN_SIZE && !((uintptr_t)message_array % SHA_HW_ALIGNMENT) && sha_hw_available())
+	{
+		size = (length & ~(SHA_HW_BLOCK_SIZE - 1));
+		
+		if (sha_hw_process_blocks(context->Intermediate_Hash, message_array, size / SHA_HW_BLOCK_SIZE))
+		{
+			message_array += size;
+			length -= size;
+		}
+	}
+
+	for(; length >= 64; message_array += 64, length -= 64) SHA1ProcessBlock(context->Intermediate_Hash, message_array);
+
+	/*
+	*  Keep the trailing partial block for the next call
+	*/
+	if (length)
+	{
+		memcpy(context->Message_Block, message_array, length);
+		context->Message_Block_Index = length;
+	}
+
 	return shaSuccess;
 }
 
 /*
- *  SHA1ProcessMessageBlock
+ *  SHA1ProcessBlock
  *
  *  Description:
  *      This function will process the next 512 bits of the message
- *      stored in the Message_Block array.
+ *      pointed to by block.
  *
  *  Parameters:
- *      None.
+ *      Intermediate_Hash: [in/out]
+ *          The hash state to update.
+ *      block: [in]
+ *          The 64-byte message block to process.
  *
  *  Returns:
  *      Nothing.
  *
  *  Comments:
-
  *      Many of the variable names in this code, especially the
  *      single character names, were used because those were the
  *      names used in the publication.
  *
- *
  */
-void SHA1ProcessMessageBlock(SHA1Context *context)
+static void SHA1ProcessBlock(uint32_t *Intermediate_Hash, const uint8_t *block)
 {
-	/* Constants defined in SHA-1 */
-	const uint32_t K[] = { 0x5A827999, 0x6ED9EBA1, 0x8F1BBCDC, 0xCA62C1D6 };
-	
 	int t;						/* Loop counter */
-	uint32_t temp;				/* Temporary word value */
-	uint32_t W[80];				/* Word sequence */
+	uint32_t W[16];				/* Rolling word sequence */
 	uint32_t A, B, C, D, E;		/* Word buffers */
 	
 	/*
-	*  Initialize the first 16 words in the array W
+	*  Initialize the first 16 words in the array W. Big endian targets
+	*  (i.e. Broadway) can load them as is
 	*/
-	for(t = 0; t < 16; t++)
-	{
-		W[t] = context->Message_Block[t * 4] << 24;
-		W[t] |= context->Message_Block[t * 4 + 1] << 16;
-		W[t] |= context->Message_Block[t * 4 + 2] << 8;
-		W[t] |= context->Message_Block[t * 4 + 3];
-	}
-	
-	for(t = 16; t < 80; t++) W[t] = SHA1CircularShift(1, W[t-3] ^ W[t-8] ^ W[t-14] ^ W[t-16]);
-	
-	A = context->Intermediate_Hash[0];
-	B = context->Intermediate_Hash[1];
-	C = context->Intermediate_Hash[2];
-	D = context->Intermediate_Hash[3];
-	E = context->Intermediate_Hash[4];
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+	(void)t;
+	memcpy(W, block, sizeof(W));
+#else
+	for(t = 0; t < 16; t++) W[t] = ((uint32_t)block[t * 4] << 24) | ((uint32_t)block[t * 4 + 1] << 16) | ((uint32_t)block[t * 4 + 2] << 8) | block[t * 4 + 3];
+#endif
 	
-	for(t = 0; t < 20; t++)
-	{
-		temp = SHA1CircularShift(5, A) + ((B & C) | ((~B) & D)) + E + W[t] + K[0];
-		E = D;
-		D = C;
-		C = SHA1CircularShift(30, B);
-		B = A;
-		A = temp;
-	}
+	A = Intermediate_Hash[0];
+	B = Intermediate_Hash[1];
+	C = Intermediate_Hash[2];
+	D = Intermediate_Hash[3];
+	E = Intermediate_Hash[4];
 	
-	for(t = 20; t < 40; t++)
-	{
-		temp = SHA1CircularShift(5, A) + (B ^ C ^ D) + E + W[t] + K[1];
-		E = D;
-		D = C;
-		C = SHA1CircularShift(30, B);
-		B = A;
-		A = temp;
-	}
+	SHA1Rounds5(R0, 0);
+	SHA1Rounds5(R0, 5);
+	SHA1Rounds5(R0, 10);
+	R0(A, B, C, D, E, 15);
+	R1(E, A, B, C, D, 16);
+	R1(D, E, A, B, C, 17);
+	R1(C, D, E, A, B, 18);
+	R1(B, C, D, E, A, 19);
 	
-	for(t = 40; t < 60; t++)
-	{
-		temp = SHA1CircularShift(5, A) + ((B & C) | (B & D) | (C & D)) + E + W[t] + K[2];
-		E = D;
-		D = C;
-		C = SHA1CircularShift(30, B);
-		B = A;
-		A = temp;
-	}
+	SHA1Rounds5(R2, 20);
+	SHA1Rounds5(R2, 25);
+	SHA1Rounds5(R2, 30);
+	SHA1Rounds5(R2, 35);
 	
-	for(t = 60; t < 80; t++)
-	{
-		temp = SHA1CircularShift(5, A) + (B ^ C ^ D) + E + W[t] + K[3];
-		E = D;
-		D = C;
-		C = SHA1CircularShift(30, B);
-		B = A;
-		A = temp;
-	}
+	SHA1Rounds5(R3, 40);
+	SHA1Rounds5(R3, 45);
+	SHA1Rounds5(R3, 50);
+	SHA1Rounds5(R3, 55);
 	
-	context->Intermediate_Hash[0] += A;
-	context->Intermediate_Hash[1] += B;
-	context->Intermediate_Hash[2] += C;
-	context->Intermediate_Hash[3] += D;
-	context->Intermediate_Hash[4] += E;
+	SHA1Rounds5(R4, 60);
+	SHA1Rounds5(R4, 65);
+	SHA1Rounds5(R4, 70);
+	SHA1Rounds5(R4, 75);
 	
-	context->Message_Block_Index = 0;
+	Intermediate_Hash[0] += A;
+	Intermediate_Hash[1] += B;
+	Intermediate_Hash[2] += C;
+	Intermediate_Hash[3] += D;
+	Intermediate_Hash[4] += E;
 }
 
+
 /*
  *  SHA1PadMessage
  *
@@ -311,10 +372,11 @@ void SHA1PadMessage(SHA1Context *context)
 	*  block, process it, and then continue padding into a second
 	*  block.
 	*/
-	if (context->Message_Block_Index > 55)
+	if (context->Message_Block_Index > 56)
 	{
 		while(context->Message_Block_Index < 64) context->Message_Block[context->Message_Block_Index++] = 0;
-		SHA1ProcessMessageBlock(context);
+		SHA1ProcessBlock(context->Intermediate_Hash, context->Message_Block);
+		context->Message_Block_Index = 0;
 	}
 	
 	while(context->Message_Block_Index < 56) context->Message_Block[context->Message_Block_Index++] = 0;
@@ -331,7 +393,49 @@ void SHA1PadMessage(SHA1Context *context)
 	context->Message_Block[62] = context->Length_Low >> 8;
 	context->Message_Block[63] = context->Length_Low;
 	
-	SHA1ProcessMessageBlock(context);
+	SHA1ProcessBlock(context->Intermediate_Hash, context->Message_Block);
+	context->Message_Block_Index = 0;
+}
+
+/*
+ *  SHA1ShortBody
+ *
+ *  Description:
+ *      Hashes a message that fits in a single padded block. Always
+ *      inlined, so callers that pass a constant length get the padding
+ *      and length fields resolved at compile time.
+ *
+ */
+static inline __attribute__((always_inline)) int SHA1ShortBody(const uint8_t *message_array, unsigned int length, uint8_t Message_Digest[SHA1HashSize])
+{
+	uint32_t Intermediate_Hash[SHA1HashSize/4] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+	uint8_t block[64] = {0};
+	int i;
+	
+	if (!message_array || !Message_Digest) return shaNull;
+	
+	if (length > SHA1ShortMaxSize) return shaInputTooLong;
+	
+	memcpy(block, message_array, length);
+	block[length] = 0x80;
+	block[62] = (length << 3) >> 8;
+	block[63] = (length << 3);
+	
+	SHA1ProcessBlock(Intermediate_Hash, block);
+	
+	for(i = 0; i < SHA1HashSize; ++i) Message_Digest[i] = Intermediate_Hash[i >> 2] >> 8 * (3 - (i & 0x03));
+	
+	return shaSuccess;
+}
+
+int SHA1Short(const uint8_t *message_array, unsigned int length, uint8_t Message_Digest[SHA1HashSize])
+{
+	return SHA1ShortBody(message_array, length, Message_Digest);
+}
+
+int SHA1_16(const uint8_t message_array[16], uint8_t Message_Digest[SHA1HashSize])
+{
+	return SHA1ShortBody(message_array, 16, Message_Digest);
 }
 
 int SHA1(uint8_t *message_array, unsigned int length, uint8_t Message_Digest[SHA1HashSize])
@@ -339,6 +443,8 @@ int SHA1(uint8_t *message_array, unsigned int length, uint8_t Message_Digest[SHA
 	int ret;
 	SHA1Context ctx;
 	
+	if (length <= SHA1ShortMaxSize) return SHA1Short(message_array, length, Message_Digest);
+	
 	ret = SHA1Reset(&ctx);
 	if (ret == shaSuccess)
 	{
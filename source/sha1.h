@@ -68,4 +68,13 @@ int SHA1Input(SHA1Context *context, uint8_t *message_array, unsigned int length)
 int SHA1Result(SHA1Context *context, uint8_t Message_Digest[SHA1HashSize]);
 int SHA1(uint8_t *message_array, unsigned int length, uint8_t Message_Digest[SHA1HashSize]);
 
+/*
+ *  Single block variants for short messages, such as key candidates.
+ *  These build the padded block directly and run a single compression.
+ */
+#define SHA1ShortMaxSize 55
+
+int SHA1Short(const uint8_t *message_array, unsigned int length, uint8_t Message_Digest[SHA1HashSize]);
+int SHA1_16(const uint8_t message_array[16], uint8_t Message_Digest[SHA1HashSize]);
+
 #endif
@@ -0,0 +1,154 @@
+#include <gccore.h>
+#include <string.h>
+
+#include "sha_hw.h"
+#include "tools.h"
+#include "mmio.h"
+
+#define HW_SHA_REG_BASE     0xD030000
+#define HW_SHA_CTRL         (HW_SHA_REG_BASE + 0x00)
+#define HW_SHA_SRC          (HW_SHA_REG_BASE + 0x04)
+#define HW_SHA_H0           (HW_SHA_REG_BASE + 0x08)
+
+#define SHA_CTRL_EXEC       0x80000000
+#define SHA_CTRL_ERR        0x20000000
+
+#define SHA_HW_STATE_WORDS  5
+#define SHA_HW_MAX_BLOCKS   0x400       // 64 KiB per command. The block count field is 10 bits wide.
+
+#define SHA_HW_TIMEOUT      0x1000000
+
+/* FIPS 180-2, appendix A.1: "abc", padded into a single block */
+static const u8 sha_hw_kat_block[SHA_HW_BLOCK_SIZE] = {
+    0x61, 0x62, 0x63, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x18
+};
+
+static const u32 sha_hw_kat_digest[SHA_HW_STATE_WORDS] = { 0xA9993E36, 0x4706816A, 0xBA3E2571, 0x7850C26C, 0x9CD0D89D };
+
+static bool sha_hw_checked = false, sha_hw_ok = false;
+static volatile u32 sha_hw_hold_count = 0;
+
+/* Taken by holds and engine commands alike, so a hold waits for the command that's currently running, if any */
+static mutex_t sha_hw_mutex = LWP_MUTEX_NULL;
+
+static bool sha_hw_reset(void)
+{
+    mmio_write32(HW_SHA_CTRL, 0);
+
+    for(u32 i = 0; i < SHA_HW_TIMEOUT; i++)
+    {
+        if (!mmio_read32(HW_SHA_CTRL)) return true;
+    }
+
+    return false;
+}
+
+static bool sha_hw_run_blocks(u32 *state, const u8 *data, u32 blocks)
+{
+    if (sha_hw_hold_count || !state || !data || !blocks || !IS_ALIGNED((uintptr_t)data, SHA_HW_ALIGNMENT)) return false;
+
+    u32 ctrl = 0;
+
+    /* Write back any cached input data before the engine reads it */
+    DCFlushRange((void*)data, blocks * SHA_HW_BLOCK_SIZE);
+
+    /* Someone else (i.e. IOS) may have been using the engine, so reload the hash state */
+    if (!sha_hw_reset()) return false;
+
+    for(u32 i = 0; i < SHA_HW_STATE_WORDS; i++) mmio_write32(HW_SHA_H0 + (i * 4), state[i]);
+
+    for(u32 offset = 0; blocks > 0;)
+    {
+        u32 cur_blocks = (blocks > SHA_HW_MAX_BLOCKS ? SHA_HW_MAX_BLOCKS : blocks);
+
+        mmio_write32(HW_SHA_SRC, mmio_dma_address(data + offset));
+        mmio_write32(HW_SHA_CTRL, SHA_CTRL_EXEC | (cur_blocks - 1));
+
+        u32 timeout = SHA_HW_TIMEOUT;
+        while(((ctrl = mmio_read32(HW_SHA_CTRL)) & SHA_CTRL_EXEC) && --timeout);
+
+        if (!timeout || (ctrl & SHA_CTRL_ERR))
+        {
+            sha_hw_reset();
+            return false;
+        }
+
+        offset += (cur_blocks * SHA_HW_BLOCK_SIZE);
+        blocks -= cur_blocks;
+    }
+
+    for(u32 i = 0; i < SHA_HW_STATE_WORDS; i++) state[i] = mmio_read32(HW_SHA_H0 + (i * 4));
+
+    return true;
+}
+
+void sha_hw_init(void)
+{
+    LWP_MutexInit(&sha_hw_mutex, false);
+}
+
+bool sha_hw_process_blocks(u32 *state, const u8 *data, u32 blocks)
+{
+    LWP_MutexLock(sha_hw_mutex);
+    bool ret = sha_hw_run_blocks(state, data, blocks);
+    LWP_MutexUnlock(sha_hw_mutex);
+
+    return ret;
+}
+
+void sha_hw_hold(void)
+{
+    LWP_MutexLock(sha_hw_mutex);
+    sha_hw_hold_count++;
+    LWP_MutexUnlock(sha_hw_mutex);
+}
+
+void sha_hw_release(void)
+{
+    LWP_MutexLock(sha_hw_mutex);
+    if (sha_hw_hold_count) sha_hw_hold_count--;
+    LWP_MutexUnlock(sha_hw_mutex);
+}
+
+bool sha_hw_held(void)
+{
+    return (sha_hw_hold_count > 0);
+}
+
+static bool sha_hw_self_test(void)
+{
+    u8 ATTRIBUTE_ALIGN(64) buf[SHA_HW_BLOCK_SIZE] = {0};
+    u32 state[SHA_HW_STATE_WORDS] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+
+    if (!AHBPROT_DISABLED) return false;
+
+    /* Make sure the engine gives the expected result before trusting it with anything else */
+    memcpy(buf, sha_hw_kat_block, sizeof(buf));
+    return (sha_hw_run_blocks(state, buf, 1) && !memcmp(state, sha_hw_kat_digest, sizeof(state)));
+}
+
+bool sha_hw_available(void)
+{
+    bool ret = false;
+
+    LWP_MutexLock(sha_hw_mutex);
+
+    /* Don't let the known answer test give a verdict we'd stick to while IOS may be using the engine */
+    if (!sha_hw_hold_count)
+    {
+        if (!sha_hw_checked)
+        {
+            sha_hw_ok = sha_hw_self_test();
+            sha_hw_checked = true;
+        }
+
+        ret = sha_hw_ok;
+    }
+
+    LWP_MutexUnlock(sha_hw_mutex);
+
+    return ret;
+}
@@ -0,0 +1,36 @@
+#ifndef __SHA_HW_H__
+#define __SHA_HW_H__
+
+#include <gctypes.h>
+
+/* Same constraints as the AES engine: it's only reachable while HW_AHBPROT is disabled, and it's shared with IOS, which uses it to hash */
+/* NAND and content data. The hash state is reloaded on every call for that reason. */
+
+#define SHA_HW_BLOCK_SIZE   64
+#define SHA_HW_ALIGNMENT    64
+
+/* Inputs smaller than this are cheaper to hash in software than to set up a DMA transfer for */
+#define SHA_HW_MIN_SIZE     0x400
+
+/* Sets up the lock that serializes holds and engine commands. Must be called once, before any other function from this file. */
+void sha_hw_init(void);
+
+/* IOS drives the engine while servicing NAND requests, so anyone with IOS requests in flight must hold it off for that long. */
+/* Callers fall back to software while it's held. Holds nest, so every sha_hw_hold() call must be paired with a sha_hw_release() call. */
+/* sha_hw_hold() waits for any engine command that's currently running, so the engine is idle by the time it returns. */
+void sha_hw_hold(void);
+void sha_hw_release(void);
+
+/* Returns true if the engine is currently being held off. */
+bool sha_hw_held(void);
+
+/* Returns true if the SHA engine can be used. Runs a known answer test the first time it's called, and sticks to its result afterwards. */
+/* Returns false without running the test while the engine is held off, so callers should check it right before every use. */
+bool sha_hw_available(void);
+
+/* Runs the SHA-1 compression function over the provided blocks using the SHA engine, updating the intermediate hash state in place. */
+/* The buffer must be aligned to a SHA_HW_ALIGNMENT boundary. Padding is left to the caller. Returns false if the engine reports an error, */
+/* in which case the hash state is left untouched. */
+bool sha_hw_process_blocks(u32 *state, const u8 *data, u32 blocks);
+
+#endif /* __SHA_HW_H__ */
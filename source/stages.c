@@ -0,0 +1,270 @@
+#include <stdarg.h>
+#include <string.h>
+#include <gccore.h>
+#include <ogc/lwp_watchdog.h>
+
+#include "stages.h"
+
+#define STAGE_STACK_SIZE        0x10000
+
+/* Both must stay below the priority of the main thread (64), so the scheduler gets to run as soon as a stage is done */
+#define STAGE_PRIORITY_CPU      48
+#define STAGE_PRIORITY_IPC      56
+
+static mutex_t stages_mutex = LWP_MUTEX_NULL;
+static cond_t stages_cond = LWP_COND_NULL;
+
+static stage_t *running_stages = NULL;
+static u32 running_stages_count = 0;
+
+static void *StageThreadFunc(void *arg)
+{
+    stage_t *stage = (stage_t*)arg;
+
+    /* Don't rely on LWP_CreateThread() having returned by the time we get here */
+    stage->thread = LWP_GetSelf();
+
+    stage->start = gettime();
+    bool success = stage->func(stage->arg);
+    stage->end = gettime();
+
+    LWP_MutexLock(stages_mutex);
+    stage->state = (success ? STAGE_STATE_SUCCEEDED : STAGE_STATE_FAILED);
+    LWP_CondSignal(stages_cond);
+    LWP_MutexUnlock(stages_mutex);
+
+    return NULL;
+}
+
+static stage_t *GetCurrentStage(void)
+{
+    if (!running_stages) return NULL;
+
+    lwp_t self = LWP_GetSelf();
+
+    for(u32 i = 0; i < running_stages_count; i++)
+    {
+        if (running_stages[i].state == STAGE_STATE_RUNNING && running_stages[i].thread == self) return &(running_stages[i]);
+    }
+
+    return NULL;
+}
+
+/* Returns true if the stage got started or was resolved right away, or false if it still has to wait for its dependencies */
+static bool StartStage(stage_t *stages, u32 count, u32 idx, bool aborted)
+{
+    stage_t *stage = &(stages[idx]);
+    u32 deps = (stage->deps & ~STAGE_DEP(idx)), after = (stage->after & ~STAGE_DEP(idx));
+    bool ready = true;
+
+    if (aborted)
+    {
+        stage->state = STAGE_STATE_SKIPPED;
+        return true;
+    }
+
+    for(u32 i = 0; i < count && deps; i++)
+    {
+        if (!(deps & STAGE_DEP(i))) continue;
+
+        switch(stages[i].state)
+        {
+            case STAGE_STATE_SUCCEEDED:
+                break;
+            case STAGE_STATE_FAILED:
+            case STAGE_STATE_SKIPPED:
+                stage->state = STAGE_STATE_SKIPPED;
+                return true;
+            default:
+                ready = false;
+                break;
+        }
+    }
+
+    /* Ordering-only dependencies just need to be done, one way or another */
+    for(u32 i = 0; i < count && ready; i++)
+    {
+        if (!(after & STAGE_DEP(i))) continue;
+        if (stages[i].state == STAGE_STATE_PENDING || stages[i].state == STAGE_STATE_RUNNING) ready = false;
+    }
+
+    if (!ready) return false;
+
+    if (!stage->func)
+    {
+        stage->state = STAGE_STATE_SUCCEEDED;
+        return true;
+    }
+
+    stage->state = STAGE_STATE_RUNNING;
+
+    if (LWP_CreateThread(&(stage->thread), StageThreadFunc, stage, NULL, STAGE_STACK_SIZE, \
+                         (stage->flags & STAGE_FLAG_IPC) ? STAGE_PRIORITY_IPC : STAGE_PRIORITY_CPU) < 0)
+    {
+        /* Run it on our own thread instead */
+        stage->thread = LWP_GetSelf();
+        LWP_MutexUnlock(stages_mutex);
+        StageThreadFunc(stage);
+        LWP_MutexLock(stages_mutex);
+        stage->thread = LWP_THREAD_NULL;
+    }
+
+    return true;
+}
+
+bool RunStages(stage_t *stages, u32 count)
+{
+    if (!stages || !count || count > STAGE_MAX_COUNT) return false;
+
+    bool aborted = false;
+
+    for(u32 i = 0; i < count; i++)
+    {
+        stages[i].state = STAGE_STATE_PENDING;
+        stages[i].thread = LWP_THREAD_NULL;
+        stages[i].start = stages[i].end = 0;
+        stages[i].log[0] = '\0';
+        stages[i].log_len = 0;
+    }
+
+    if (LWP_MutexInit(&stages_mutex, false) < 0) return false;
+
+    if (LWP_CondInit(&stages_cond) < 0)
+    {
+        LWP_MutexDestroy(stages_mutex);
+        stages_mutex = LWP_MUTEX_NULL;
+        return false;
+    }
+
+    LWP_MutexLock(stages_mutex);
+
+    running_stages = stages;
+    running_stages_count = count;
+
+    while(true)
+    {
+        u32 running = 0;
+
+        /* Reap finished stages and check if we need to stop starting new ones */
+        for(u32 i = 0; i < count; i++)
+        {
+            stage_t *stage = &(stages[i]);
+
+            if ((stage->state == STAGE_STATE_SUCCEEDED || stage->state == STAGE_STATE_FAILED) && stage->thread != LWP_THREAD_NULL)
+            {
+                LWP_MutexUnlock(stages_mutex);
+                LWP_JoinThread(stage->thread, NULL);
+                LWP_MutexLock(stages_mutex);
+                stage->thread = LWP_THREAD_NULL;
+            }
+
+            if (stage->state == STAGE_STATE_FAILED && (stage->flags & STAGE_FLAG_CRITICAL)) aborted = true;
+        }
+
+        /* Start every pending stage whose dependencies are met. Keep going until nothing else can be resolved, since skipped stages may cascade */
+        bool progress = true;
+        while(progress)
+        {
+            progress = false;
+
+            for(u32 i = 0; i < count; i++)
+            {
+                if (stages[i].state == STAGE_STATE_PENDING && StartStage(stages, count, i, aborted)) progress = true;
+                if (stages[i].state == STAGE_STATE_FAILED && (stages[i].flags & STAGE_FLAG_CRITICAL)) aborted = true;
+            }
+        }
+
+        for(u32 i = 0; i < count; i++)
+        {
+            if (stages[i].state == STAGE_STATE_RUNNING) running++;
+        }
+
+        if (!running) break;
+
+        /* Wait for any running stage to finish */
+        LWP_CondWait(stages_cond, stages_mutex);
+    }
+
+    /* Anything still pending at this point depends on a stage that doesn't exist */
+    for(u32 i = 0; i < count; i++)
+    {
+        if (stages[i].state == STAGE_STATE_PENDING) stages[i].state = STAGE_STATE_SKIPPED;
+    }
+
+    running_stages = NULL;
+    running_stages_count = 0;
+
+    LWP_MutexUnlock(stages_mutex);
+
+    LWP_CondDestroy(stages_cond);
+    stages_cond = LWP_COND_NULL;
+
+    LWP_MutexDestroy(stages_mutex);
+    stages_mutex = LWP_MUTEX_NULL;
+
+    return !aborted;
+}
+
+void StagePrintf(const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+
+    stage_t *stage = GetCurrentStage();
+    if (stage)
+    {
+        if (stage->log_len < (STAGE_LOG_SIZE - 1))
+        {
+            int len = vsnprintf(stage->log + stage->log_len, STAGE_LOG_SIZE - stage->log_len, fmt, args);
+            if (len > 0) stage->log_len += ((u32)len < (STAGE_LOG_SIZE - stage->log_len) ? (u32)len : (STAGE_LOG_SIZE - stage->log_len - 1));
+        }
+    } else {
+        vprintf(fmt, args);
+    }
+
+    va_end(args);
+}
+
+void PrintStageLogs(const stage_t *stages, u32 count, FILE *fp)
+{
+    if (!stages || !fp) return;
+
+    for(u32 i = 0; i < count; i++)
+    {
+        if (stages[i].log_len) fputs(stages[i].log, fp);
+    }
+}
+
+u64 GetStagesSequentialTicks(const stage_t *stages, u32 count)
+{
+    u64 ticks = 0;
+
+    for(u32 i = 0; stages && i < count; i++)
+    {
+        if (stages[i].end > stages[i].start) ticks += diff_ticks(stages[i].start, stages[i].end);
+    }
+
+    return ticks;
+}
+
+void PrintStageTimings(const stage_t *stages, u32 count, u64 wall_ticks, FILE *fp)
+{
+    if (!stages || !fp) return;
+
+    for(u32 i = 0; i < count; i++)
+    {
+        const stage_t *stage = &(stages[i]);
+        if (!stage->func) continue;
+
+        if (stage->state == STAGE_STATE_SKIPPED)
+        {
+            fprintf(fp, "%-16s skipped\n", stage->name);
+        } else {
+            fprintf(fp, "%-16s %8u us%s\n", stage->name, (u32)ticks_to_microsecs(diff_ticks(stage->start, stage->end)), \
+                    stage->state == STAGE_STATE_FAILED ? " (failed)" : "");
+        }
+    }
+
+    fprintf(fp, "%-16s %8u us\n", "Sequential", (u32)ticks_to_microsecs(GetStagesSequentialTicks(stages, count)));
+    fprintf(fp, "%-16s %8u us\n", "Wall-clock", (u32)ticks_to_microsecs(wall_ticks));
+}
@@ -0,0 +1,63 @@
+#ifndef __STAGES_H__
+#define __STAGES_H__
+
+#include <stdio.h>
+#include <gctypes.h>
+#include <ogc/lwp.h>
+
+#define STAGE_MAX_COUNT         32
+#define STAGE_LOG_SIZE          0x200
+
+#define STAGE_DEP(x)            (1U << (x))
+
+typedef enum {
+    STAGE_FLAG_NONE     = 0,
+    STAGE_FLAG_IPC      = (1U << 0),    // Spends most of its time blocked on IOS IPC, so it gets to preempt CPU-bound stages as soon as IOS replies.
+    STAGE_FLAG_CRITICAL = (1U << 1)     // No further stages are started if this one fails.
+} stage_flags_t;
+
+typedef enum {
+    STAGE_STATE_PENDING = 0,
+    STAGE_STATE_RUNNING,
+    STAGE_STATE_SUCCEEDED,
+    STAGE_STATE_FAILED,
+    STAGE_STATE_SKIPPED
+} stage_state_t;
+
+typedef bool (*stage_func_t)(void *arg);
+
+/* A single unit of work. Stages without a function are treated as already done, which makes it easy to disable them on specific consoles. */
+typedef struct {
+    const char *name;
+    stage_func_t func;
+    void *arg;
+    u32 deps;                   // STAGE_DEP() mask of the stages that must succeed before this one is started.
+    u32 flags;                  // stage_flags_t.
+    u32 after;                  // STAGE_DEP() mask of the stages that must be done before this one is started, regardless of their outcome.
+
+    /* Filled by RunStages() */
+    stage_state_t state;
+    lwp_t thread;
+    u64 start, end;
+    char log[STAGE_LOG_SIZE];
+    u32 log_len;
+} stage_t;
+
+/* Runs all provided stages on their own LWP threads as soon as their dependencies are met, and waits for all of them to finish. */
+/* Stages whose dependencies failed are skipped. Returns false if a critical stage failed. */
+bool RunStages(stage_t *stages, u32 count);
+
+/* printf() replacement for code that may run within a stage. Output is kept in the stage log, so it can be printed in a deterministic order afterwards. */
+/* Falls back to printf() if called from outside a stage. */
+void StagePrintf(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+/* Prints the logs from all provided stages in table order. */
+void PrintStageLogs(const stage_t *stages, u32 count, FILE *fp);
+
+/* Prints the time spent by each provided stage, followed by the sum of all of them and the provided wall-clock time. */
+void PrintStageTimings(const stage_t *stages, u32 count, u64 wall_ticks, FILE *fp);
+
+/* Returns the sum of the time spent by each provided stage, in ticks. This is how long they would have taken if run in sequence. */
+u64 GetStagesSequentialTicks(const stage_t *stages, u32 count);
+
+#endif /* __STAGES_H__ */
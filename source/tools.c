@@ -7,6 +7,14 @@
 #include <ogc/machine/processor.h>
 
 #include "tools.h"
+#include "mempatch.h"
+#include "keyhints.h"
+#include "stages.h"
+
+#define ISFS_PERM_HINT_NAME "isfs_perm"
+
+#define ISFS_ENTRY_NAME_SIZE        13  // 12 characters + NULL terminator.
+#define ISFS_DIR_LIST_DEFAULT_COUNT 32
 
 #define USB_REG_BASE		0x0D040000
 #define USB_REG_OP_BASE		(USB_REG_BASE + (read32(USB_REG_BASE) & 0xff))
@@ -34,10 +42,6 @@ static storage_device_type_t device_type = STORAGE_DEVICE_TYPE_NONE;
 static u64 tmd_tid ATTRIBUTE_ALIGN(32) = 0;
 static u32 tmd_size ATTRIBUTE_ALIGN(32) = 0;
 
-static s32 isfs_fd ATTRIBUTE_ALIGN(32) = 0;
-static char isfs_file_path[ISFS_MAXPATH] ATTRIBUTE_ALIGN(32) = {0};
-static fstats isfs_file_stats ATTRIBUTE_ALIGN(32) = {0};
-
 bool IsWiiU(void)
 {
     s32 ret = 0;
@@ -160,44 +164,55 @@ void DisableMemoryProtection(void)
     mask32(MEM_PROT, 0xFFFF0000, 0);
 }
 
-static bool ApplyMemoryPatch(const u8 *pattern, u32 pattern_size, const u8 *patch, u32 patch_size, s32 patch_offset, bool patch_all)
+bool PatchNandFsPermissions(void)
 {
-    if (!pattern || !pattern_size || !patch || !patch_size) return false;
-
-    u32 count = 0;
+    char hint_context[KEYHINT_CONTEXT_LENGTH] = {0};
+    u32 offset = 0;
 
-    /* Look for the desired pattern and patch it */
-    for(u32 addr = MEM2_IOS_LOOKUP_START; addr < MEM2_IOS_LOOKUP_END; addr++)
-    {
-        u32 patch_addr = (u32)((s32)addr + patch_offset);
+    mem_patch_t patches[] = {
+        {
+            .name = ISFS_PERM_HINT_NAME,
+            .pattern = g_isfsPermOld,
+            .pattern_size = sizeof(g_isfsPermOld),
+            .patch = g_isfsPermPatch,
+            .patch_size = sizeof(g_isfsPermPatch),
+            .patch_offset = 0,
+            .patch_all = false
+        }
+    };
 
-        /* Bail out if a read operation could exceed our memory extents */
-        if ((addr + pattern_size) > MEM2_IOS_LOOKUP_END || (patch_addr + patch_size) > MEM2_IOS_LOOKUP_END) break;
+    /* The pattern location only depends on the currently loaded IOS build */
+    sprintf(hint_context, "%s-IOS%d-v%d", g_isvWii ? "vWii" : "Wii", IOS_GetVersion(), IOS_GetRevision());
 
-        /* Check if we have found the pattern */
-        if (memcmp((u8*)addr, pattern, pattern_size) != 0) continue;
+    /* Known IOS builds only need a single compare at the hinted offset */
+    if (LookupKeyHint(hint_context, patches[0].name, &offset) && \
+        ApplyMemoryPatchAt(&(patches[0]), MEM2_IOS_LOOKUP_START + offset, MEM2_IOS_LOOKUP_START, MEM2_IOS_LOOKUP_END))
+    {
+        StagePrintf("\"%s\" patched at hinted address 0x%08X.\n\n", patches[0].name, patches[0].first_match);
+        return true;
+    }
 
-        /* In order to properly patch the desired pattern, we must tweak both d-cache and L1 i-cache */
-        /* We must guarantee the addresses and sizes are aligned to a 32-byte boundary */
-        void *patch_addr_align = (void*)ALIGN_DOWN(patch_addr, 0x20);
-        u32 patch_size_align = ALIGN_UP(patch_size, 0x20);
+    /* Unknown IOS build (or stale hint): sweep the whole lookup area. Further IOS patches can be added to the table above without requiring another sweep */
+    ApplyMemoryPatches(patches, MAX_ELEMENTS(patches), MEM2_IOS_LOOKUP_START, MEM2_IOS_LOOKUP_END);
 
-        DCInvalidateRange(patch_addr_align, patch_size_align);
-        memcpy((void*)patch_addr, patch, patch_size);
-        DCFlushRange(patch_addr_align, patch_size_align);
-        ICInvalidateRange(patch_addr_align, patch_size_align);
+    for(u32 i = 0; i < MAX_ELEMENTS(patches); i++)
+    {
+        if (patches[i].matches)
+        {
+            StagePrintf("\"%s\" patched at %u location(s), starting at 0x%08X.\n", patches[i].name, patches[i].matches, patches[i].first_match);
+        } else {
+            StagePrintf("\"%s\" pattern not found!\n", patches[i].name);
+        }
+    }
 
-        count++;
+    StagePrintf("\n");
 
-        if (!patch_all) break;
-    }
+    if (!patches[0].matches) return false;
 
-    return (count > 0);
-}
+    /* Remember where we found it */
+    AddKeyHint(hint_context, patches[0].name, patches[0].first_match - MEM2_IOS_LOOKUP_START);
 
-bool PatchNandFsPermissions(void)
-{
-    return ApplyMemoryPatch(g_isfsPermOld, sizeof(g_isfsPermOld), g_isfsPermPatch, sizeof(g_isfsPermPatch), 0, false);
+    return true;
 }
 
 static void SetHighlight(bool highlight)
@@ -450,27 +465,27 @@ signed_blob *GetSignedTMDFromTitle(u64 title_id, u32 *out_size)
     ret = ES_GetStoredTMDSize(tmd_tid, &tmd_size);
     if (ret < 0)
     {
-        printf("ES_GetStoredTMDSize failed! (%d) (TID %X-%X)\n", ret, TITLE_UPPER(tmd_tid), TITLE_LOWER(tmd_tid));
+        StagePrintf("ES_GetStoredTMDSize failed! (%d) (TID %X-%X)\n", ret, TITLE_UPPER(tmd_tid), TITLE_LOWER(tmd_tid));
         return NULL;
     }
 
     stmd = (signed_blob*)memalign(32, ALIGN_UP(tmd_size, 32));
     if (!stmd)
     {
-        printf("Failed to allocate memory for TMD! (TID %X-%X)\n", TITLE_UPPER(tmd_tid), TITLE_LOWER(tmd_tid));
+        StagePrintf("Failed to allocate memory for TMD! (TID %X-%X)\n", TITLE_UPPER(tmd_tid), TITLE_LOWER(tmd_tid));
         return NULL;
     }
 
     ret = ES_GetStoredTMD(tmd_tid, stmd, tmd_size);
     if (ret < 0)
     {
-        printf("ES_GetStoredTMD failed! (%d) (TID %X-%X)\n", ret, TITLE_UPPER(tmd_tid), TITLE_LOWER(tmd_tid));
+        StagePrintf("ES_GetStoredTMD failed! (%d) (TID %X-%X)\n", ret, TITLE_UPPER(tmd_tid), TITLE_LOWER(tmd_tid));
         goto out;
     }
 
     if (!IS_VALID_SIGNATURE(stmd))
     {
-        printf("Invalid TMD signature! (TID %X-%X)\n", TITLE_UPPER(tmd_tid), TITLE_LOWER(tmd_tid));
+        StagePrintf("Invalid TMD signature! (TID %X-%X)\n", TITLE_UPPER(tmd_tid), TITLE_LOWER(tmd_tid));
         goto out;
     }
 
@@ -487,51 +502,74 @@ out:
     return stmd;
 }
 
-void *ReadFileFromFlashFileSystem(const char *path, u32 *out_size)
+s32 OpenFileFromFlashFileSystem(const char *path, u32 *out_size)
 {
-    if (!path || !strlen(path) || !out_size) return NULL;
+    if (!path || !strlen(path) || !out_size) return ISFS_EINVAL;
 
-    s32 ret = 0;
-    u8 *buf = NULL;
-    bool success = false;
+    /* Keep everything local, so files can be opened from multiple threads at once */
+    fstats ATTRIBUTE_ALIGN(32) file_stats = {0};
+    s32 fd = 0, ret = 0;
 
-    snprintf(isfs_file_path, ISFS_MAXPATH, "%s", path);
-
-    isfs_fd = ISFS_Open(isfs_file_path, ISFS_OPEN_READ);
-    if (isfs_fd < 0)
+    fd = ISFS_Open(path, ISFS_OPEN_READ);
+    if (fd < 0)
     {
-        printf("ISFS_Open(\"%s\") failed! (%d)\n", isfs_file_path, isfs_fd);
-        return NULL;
+        StagePrintf("ISFS_Open(\"%s\") failed! (%d)\n", path, fd);
+        return fd;
     }
 
-    ret = ISFS_GetFileStats(isfs_fd, &isfs_file_stats);
+    ret = ISFS_GetFileStats(fd, &file_stats);
     if (ret < 0)
     {
-        printf("ISFS_GetFileStats(\"%s\") failed! (%d)\n", isfs_file_path, ret);
-        goto out;
+        StagePrintf("ISFS_GetFileStats(\"%s\") failed! (%d)\n", path, ret);
+        ISFS_Close(fd);
+        return ret;
     }
 
-    if (!isfs_file_stats.file_length)
+    if (!file_stats.file_length)
     {
-        printf("\"%s\" is empty!\n", isfs_file_path);
-        goto out;
+        StagePrintf("\"%s\" is empty!\n", path);
+        ISFS_Close(fd);
+        return ISFS_EINVAL;
     }
 
-    buf = (u8*)memalign(32, ALIGN_UP(isfs_file_stats.file_length, 32));
+    *out_size = file_stats.file_length;
+
+    return fd;
+}
+
+s32 ReadFileChunkFromFlashFileSystem(s32 fd, void *buf, u32 size)
+{
+    if (fd < 0 || !buf || !size || !IS_ALIGNED((u32)buf, 32)) return ISFS_EINVAL;
+
+    s32 ret = ISFS_Read(fd, buf, size);
+    if (ret < 0) StagePrintf("ISFS_Read(%d) failed! (%d)\n", fd, ret);
+
+    return ret;
+}
+
+void *ReadFileFromFlashFileSystem(const char *path, u32 *out_size)
+{
+    if (!path || !strlen(path) || !out_size) return NULL;
+
+    s32 fd = 0, ret = 0;
+    u32 file_size = 0;
+    u8 *buf = NULL;
+    bool success = false;
+
+    fd = OpenFileFromFlashFileSystem(path, &file_size);
+    if (fd < 0) return NULL;
+
+    buf = (u8*)memalign(32, ALIGN_UP(file_size, 32));
     if (!buf)
     {
-        printf("Failed to allocate memory for \"%s\"!\n", isfs_file_path);
+        StagePrintf("Failed to allocate memory for \"%s\"!\n", path);
         goto out;
     }
 
-    ret = ISFS_Read(isfs_fd, buf, isfs_file_stats.file_length);
-    if (ret < 0)
-    {
-        printf("ISFS_Read(\"%s\") failed! (%d)\n", isfs_file_path, ret);
-        goto out;
-    }
+    ret = ReadFileChunkFromFlashFileSystem(fd, buf, file_size);
+    if (ret < 0) goto out;
 
-    *out_size = isfs_file_stats.file_length;
+    *out_size = file_size;
     success = true;
 
 out:
@@ -541,23 +579,64 @@ out:
         buf = NULL;
     }
 
-    ISFS_Close(isfs_fd);
-    isfs_fd = 0;
+    ISFS_Close(fd);
 
     return (void*)buf;
 }
 
-bool CheckIfFlashFileSystemFileExists(const char *path)
+static char *ReadFlashFileSystemDirectory(const char *path, u32 max_count, u32 *out_count)
+{
+    char *list = (char*)memalign(32, ALIGN_UP(max_count * ISFS_ENTRY_NAME_SIZE, 32));
+    if (!list)
+    {
+        StagePrintf("Failed to allocate memory for \"%s\" directory listing!\n", path);
+        return NULL;
+    }
+
+    u32 count = max_count;
+
+    if (ISFS_ReadDir(path, list, &count) < 0)
+    {
+        free(list);
+        return NULL;
+    }
+
+    *out_count = count;
+
+    return list;
+}
+
+char *ListFlashFileSystemDirectory(const char *path, u32 *out_count)
 {
-    if (!path || !strlen(path)) return NULL;
+    if (!path || !strlen(path) || !out_count) return NULL;
+
+    u32 count = 0, total = 0;
+
+    /* Most directories fit within our default guess, which saves us from asking IOS for the entry count beforehand */
+    char *list = ReadFlashFileSystemDirectory(path, ISFS_DIR_LIST_DEFAULT_COUNT, &count);
+    if (!list) return NULL;
 
-    snprintf(isfs_file_path, ISFS_MAXPATH, "%s", path);
+    /* The listing may have been truncated, so ask for the actual entry count and try again if needed */
+    if (count >= ISFS_DIR_LIST_DEFAULT_COUNT && ISFS_ReadDir(path, NULL, &total) >= 0 && total > count)
+    {
+        free(list);
+        list = ReadFlashFileSystemDirectory(path, total, &count);
+        if (!list) return NULL;
+    }
 
-    isfs_fd = ISFS_Open(isfs_file_path, ISFS_OPEN_READ);
-    if (isfs_fd < 0) return false;
+    *out_count = count;
 
-    ISFS_Close(isfs_fd);
-    isfs_fd = 0;
+    return list;
+}
 
-    return true;
+bool IsNameInFlashFileSystemDirectoryList(const char *list, u32 count, const char *name)
+{
+    if (!list || !name) return false;
+
+    for(u32 i = 0; i < count; i++, list += (strlen(list) + 1))
+    {
+        if (!strcmp(list, name)) return true;
+    }
+
+    return false;
 }
@@ -8,6 +8,8 @@
 #include <sys/stat.h>
 #include <ogc/machine/processor.h>
 
+#include "mmio.h"
+
 #define VERSION                     "1.3.3"
 
 //#define IsWiiU()                  (((*(vu32*)0xCD8005A0) >> 16) == 0xCAFE)
@@ -19,12 +21,12 @@
 
 #define ALIGN_UP(x, y)              (((x) + ((y) - 1)) & ~((y) - 1))
 #define ALIGN_DOWN(x, y)            ((x) & ~((y) - 1))
+#define IS_ALIGNED(x, y)            (((x) & ((y) - 1)) == 0)
 
 #define MAX_ELEMENTS(x)             (sizeof((x)) / sizeof((x)[0]))
 
 #define MEMBER_SIZE(type, member)   sizeof(((type*)NULL)->member)
 
-#define HW_SRNPROT                  0xD800060
 #define HW_AHBPROT                  0xD800064
 #define MEM_PROT                    0xD8B420A
 
@@ -32,7 +34,7 @@
 #define MEM2_IOS_LOOKUP_START       0x93400000
 #define MEM2_IOS_LOOKUP_END         0x94000000
 
-#define AHBPROT_DISABLED            (read32(HW_AHBPROT) == 0xFFFFFFFF)
+#define AHBPROT_DISABLED            (mmio_read32(HW_AHBPROT) == 0xFFFFFFFF)
 
 extern bool g_isvWii;
 
@@ -47,6 +49,8 @@ void InitConsole();
 void PrintHeadline();
 
 void DisableMemoryProtection(void);
+/* Checks the "isfs_perm" key hint for the currently loaded IOS build first (context "<Wii|vWii>-IOS<version>-v<revision>", offset relative */
+/* to MEM2_IOS_LOOKUP_START), and only sweeps MEM2 if it misses. Key hints must be loaded beforehand. */
 bool PatchNandFsPermissions(void);
 
 void UnmountStorageDevice(void);
@@ -56,6 +60,7 @@ const char *StorageDeviceMountName(void);
 
 void HexKeyDump(FILE *fp, const void *d, size_t len, bool add_spaces);
 
+/* The TMD and NAND helpers below may run within extraction stages, so their error messages go through StagePrintf(). */
 signed_blob *GetSignedTMDFromTitle(u64 title_id, u32 *out_size);
 
 static inline tmd *GetTMDFromSignedBlob(signed_blob *stmd)
@@ -64,8 +69,18 @@ static inline tmd *GetTMDFromSignedBlob(signed_blob *stmd)
     return (tmd*)((u8*)stmd + SIGNATURE_SIZE(stmd));
 }
 
+/* Opens a file from the NAND filesystem for reading and returns its descriptor (or a negative error code). Must be closed with ISFS_Close(). */
+s32 OpenFileFromFlashFileSystem(const char *path, u32 *out_size);
+
+/* Reads the next chunk from a file opened with OpenFileFromFlashFileSystem(). The output buffer must be aligned to a 32-byte boundary. */
+s32 ReadFileChunkFromFlashFileSystem(s32 fd, void *buf, u32 size);
+
 void *ReadFileFromFlashFileSystem(const char *path, u32 *out_size);
 
-bool CheckIfFlashFileSystemFileExists(const char *path);
+/* Lists the entries from a NAND directory as consecutive NULL-terminated names. Returns NULL if the directory can't be read. Must be freed by the caller. */
+char *ListFlashFileSystemDirectory(const char *path, u32 *out_count);
+
+/* Checks if the provided name is part of a listing returned by ListFlashFileSystemDirectory(). */
+bool IsNameInFlashFileSystemDirectoryList(const char *list, u32 count, const char *name);
 
 #endif /* __TOOLS_H__ */
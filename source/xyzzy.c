@@ -13,6 +13,7 @@
 #include <string.h>
 #include <gccore.h>
 #include <network.h>
+#include <ogc/lwp_watchdog.h>
 
 #include "tools.h"
 #include "otp.h"
@@ -20,8 +21,15 @@
 #include "vwii_sram_otp.h"
 #include "sha1.h"
 #include "aes.h"
+#include "sha_hw.h"
+#include "aes_hw.h"
 #include "boot0.h"
-#include "xxhash.h"
+#include "keyscan.h"
+#include "keyhints.h"
+#include "ios_image.h"
+#include "dol.h"
+#include "stages.h"
+#include "isfs_stream.h"
 
 #define SYSTEM_MENU_TID     (u64)0x0000000100000002
 
@@ -29,6 +37,10 @@
 #define DEVCERT_SIZE        0x180
 
 #define ANCAST_HEADER_MAGIC (u32)0xEFA282D9
+#define ANCAST_HEADER_OFFSET    0x500
+#define ANCAST_BODY_OFFSET      (ANCAST_HEADER_OFFSET + sizeof(ppc_ancast_image_header_t))
+
+#define SYSMENU_CHUNK_SIZE  0x10000
 
 typedef struct {
     char human_info[0x100];
@@ -43,14 +55,6 @@ typedef struct {
     sha1 content_hash;
 } __attribute__((packed)) content_map_entry_t;
 
-typedef struct {
-    u8 key[64];
-    u32 key_size;
-    u32 xxhash;
-    u8 hash[SHA1HashSize];
-    bool retrieved;
-} additional_keyinfo_t;
-
 typedef struct {
     u32 magic;
     u32 unk_1;
@@ -70,58 +74,88 @@ typedef struct {
     u8 padding_2[0x3C];
 } ppc_ancast_image_header_t;
 
+typedef enum {
+    ADDITIONAL_KEY_SD_KEY = 0,
+    ADDITIONAL_KEY_SD_IV,
+    ADDITIONAL_KEY_MD5_BLANKER,
+    ADDITIONAL_KEY_MAC_ADDRESS,
+    ADDITIONAL_KEY_COUNT
+} additional_key_idx_t;
+
 static const u8 ATTRIBUTE_ALIGN(16) vwii_ancast_key[0x10] = { 0x2E, 0xFE, 0x8A, 0xBC, 0xED, 0xBB, 0x7B, 0xAA, 0xE3, 0xC0, 0xED, 0x92, 0xFA, 0x29, 0xF8, 0x66 };
 static const u8 ATTRIBUTE_ALIGN(16) vwii_ancast_iv[0x10]  = { 0x59, 0x6D, 0x5A, 0x9A, 0xD7, 0x05, 0xF9, 0x4F, 0xE1, 0x58, 0x02, 0x6F, 0xEA, 0xA7, 0xB8, 0x87 };
 
+/* Decryption key schedule for the vWii Ancast Key. Only expanded once, then shared by every decryption call */
+static aes_ctx vwii_ancast_aes_ctx = {0};
+static bool vwii_ancast_aes_ctx_ready = false;
+
 static u8 otp_ptr[OTP_SIZE] = {0};
 static u8 seeprom_ptr[SEEPROM_SIZE] = {0};
 
-static additional_keyinfo_t additional_keys[] = {
-    {
+static additional_keyinfo_t additional_keys[ADDITIONAL_KEY_COUNT] = {
+    [ADDITIONAL_KEY_SD_KEY] = {
         // SD Key. Retrieved from the ES module from the current IOS.
         .key = {0},
         .key_size = 16,
         .xxhash = 0xF655F81B,
         .hash = { 0x10, 0x37, 0xD8, 0x80, 0x10, 0x2F, 0xF0, 0x21, 0xC2, 0x2B, 0xA8, 0xF5, 0xDF, 0x53, 0xD7, 0x98, 0xCF, 0x44, 0xDD, 0x0B },
-        .retrieved = false
+        .prefilter = 0x04A7,
+        .retrieved = false,
+        .offset = 0
     },
-    {
+    [ADDITIONAL_KEY_SD_IV] = {
         // SD IV. Retrieved from System Menu binary.
         .key = {0},
         .key_size = 16,
         .xxhash = 0xBBD8F75D,
         .hash = { 0x25, 0xAE, 0xEF, 0x2E, 0x60, 0x1E, 0xDE, 0x3E, 0x16, 0x17, 0x54, 0x3B, 0xEB, 0x2E, 0xDE, 0xB0, 0x8A, 0xF8, 0x7D, 0xA8 },
-        .retrieved = false
+        .prefilter = 0x0D39,
+        .retrieved = false,
+        .offset = 0
     },
-    {
+    [ADDITIONAL_KEY_MD5_BLANKER] = {
         // MD5 Blanker. Retrieved from System Menu binary.
         .key = {0},
         .key_size = 16,
         .xxhash = 0xEE88846F,
         .hash = { 0x3D, 0xAB, 0xA9, 0xEF, 0x67, 0xCA, 0x94, 0xBF, 0x08, 0x28, 0xEC, 0x04, 0x39, 0x4A, 0x53, 0x13, 0x4D, 0x33, 0x1C, 0x1F },
-        .retrieved = false
+        .prefilter = 0x055E,
+        .retrieved = false,
+        .offset = 0
     },
-    {
+    [ADDITIONAL_KEY_MAC_ADDRESS] = {
         // MAC Address. Retrieved from /dev/net virtual device. Console specific so this isn't hashed. Used to generate custom savedata.
         .key = {0},
         .key_size = 6,
         .xxhash = 0,
         .hash = {0},
-        .retrieved = false
+        .prefilter = 0,
+        .retrieved = false,
+        .offset = 0
     }
 };
 
-static const char *priiloader_files[] = {
-    "content/title_or.tmd",
-    "data/loader.ini",
-    "data/hackshas.ini",
-    "data/hacksh_s.ini",
-    "data/password.txt",
-    "data/main.nfo",
-    "data/main.bin"
+/* Used to look up and store key offset hints. Keys without a name aren't retrieved from memory. */
+static const char *additional_key_hint_names[ADDITIONAL_KEY_COUNT] = {
+    [ADDITIONAL_KEY_SD_KEY] = "sd_key",
+    [ADDITIONAL_KEY_SD_IV] = "sd_iv",
+    [ADDITIONAL_KEY_MD5_BLANKER] = "md5_blanker",
+    [ADDITIONAL_KEY_MAC_ADDRESS] = NULL
 };
 
-static const u32 priiloader_files_count = (u32)MAX_ELEMENTS(priiloader_files);
+/* Files left behind by Priiloader within the System Menu content and data directories, respectively */
+static const char *priiloader_content_files[] = {
+    "title_or.tmd"
+};
+
+static const char *priiloader_data_files[] = {
+    "loader.ini",
+    "hackshas.ini",
+    "hacksh_s.ini",
+    "password.txt",
+    "main.nfo",
+    "main.bin"
+};
 
 static const char *key_names_stdout[] = {
     "boot1 Hash   ",
@@ -182,8 +216,23 @@ static bool SEEPROM_ReadData(void)
 {
     SEEPROM_ClearData();
 
+    u64 start = gettime();
     u16 ret = seeprom_read(seeprom_ptr, 0, SEEPROM_SIZE);
 
+    /* Fall back to a calibrated (and possibly slower) clock if the known fields don't read back correctly */
+    if (ret != SEEPROM_SIZE || !seeprom_check_known_fields(seeprom_ptr))
+    {
+        StagePrintf("SEEPROM readback failed at %u ns clock half-period, calibrating...\n", seeprom_get_half_period());
+
+        SEEPROM_ClearData();
+        seeprom_calibrate(seeprom_get_half_period());
+
+        start = gettime();
+        ret = seeprom_read(seeprom_ptr, 0, SEEPROM_SIZE);
+    }
+
+    StagePrintf("SEEPROM dumped in %u us (%u ns clock half-period).\n\n", (u32)diff_usec(start, gettime()), seeprom_get_half_period());
+
     return (ret == SEEPROM_SIZE && *(((u32*)seeprom_ptr) + 2) != 0);
 }
 
@@ -191,21 +240,21 @@ static bool FillOTPStruct(otp_t **out)
 {
     if (!out)
     {
-        printf("Fatal error: invalid output OTP struct pointer.\n\n");
+        StagePrintf("Fatal error: invalid output OTP struct pointer.\n\n");
         return false;
     }
 
     otp_t *otp_data = memalign(32, sizeof(otp_t));
     if (!otp_data)
     {
-        printf("Fatal error: unable to allocate memory for OTP struct.\n\n");
+        StagePrintf("Fatal error: unable to allocate memory for OTP struct.\n\n");
         return false;
     }
 
     /* Read OTP data into otp_ptr pointer */
     if (!OTP_ReadData())
     {
-        printf("Fatal error: OTP_ReadData() failed.\n\n");
+        StagePrintf("Fatal error: OTP_ReadData() failed.\n\n");
         OTP_ClearData();
         return false;
     }
@@ -224,21 +273,21 @@ static bool FillSEEPROMStruct(seeprom_t **out)
 {
     if (!out)
     {
-        printf("Fatal error: invalid output SEEPROM struct pointer.\n\n");
+        StagePrintf("Fatal error: invalid output SEEPROM struct pointer.\n\n");
         return false;
     }
 
     seeprom_t *seeprom_data = memalign(32, sizeof(seeprom_t));
     if (!seeprom_data)
     {
-        printf("Fatal error: unable to allocate memory for SEEPROM struct.\n\n");
+        StagePrintf("Fatal error: unable to allocate memory for SEEPROM struct.\n\n");
         return false;
     }
 
     /* Read SEEPROM data into seeprom_ptr pointer */
     if (!SEEPROM_ReadData())
     {
-        printf("Fatal error: SEEPROM_ReadData() failed.\n\n");
+        StagePrintf("Fatal error: SEEPROM_ReadData() failed.\n\n");
         SEEPROM_ClearData();
         return false;
     }
@@ -257,14 +306,14 @@ static bool FillBootMiiKeysStruct(otp_t *otp_data, seeprom_t *seeprom_data, boot
 {
     if (!otp_data || !seeprom_data || !out)
     {
-        printf("Fatal error: invalid OTP/SEEPROM/BootMiiKeys struct pointer(s).\n\n");
+        StagePrintf("Fatal error: invalid OTP/SEEPROM/BootMiiKeys struct pointer(s).\n\n");
         return false;
     }
 
     bootmii_keys_bin_t *bootmii_keys = memalign(32, sizeof(bootmii_keys_bin_t));
     if (!bootmii_keys)
     {
-        printf("Fatal error: unable to allocate memory for BootMiiKeys struct.\n\n");
+        StagePrintf("Fatal error: unable to allocate memory for BootMiiKeys struct.\n\n");
         return false;
     }
 
@@ -286,173 +335,536 @@ static bool FillBootMiiKeysStruct(otp_t *otp_data, seeprom_t *seeprom_data, boot
     return true;
 }
 
-static void RetrieveSDKey(void)
+static void UpdateAdditionalKeyHints(const char *hint_context, const additional_key_idx_t *key_idx, u32 key_count)
 {
-    sha1 hash = {0};
-    additional_keyinfo_t *sd_key = &(additional_keys[0]);
-
-    /* Look for our key within the currently loaded IOS binary */
-    for(u32 addr = MEM2_IOS_LOOKUP_START; addr < MEM2_IOS_LOOKUP_END; addr += 4)
+    for(u32 i = 0; i < key_count; i++)
     {
-        /* Bail out if a read operation could exceed our memory extents */
-        if ((addr + sd_key->key_size) > MEM2_IOS_LOOKUP_END) break;
+        const char *name = additional_key_hint_names[key_idx[i]];
+        if (name && additional_keys[key_idx[i]].retrieved) AddKeyHint(hint_context, name, additional_keys[key_idx[i]].offset);
+    }
+}
+
+static void RetrieveKeysFromBuffer(const char *hint_context, const void *buf, u32 buf_size, const keyscan_range_t *ranges, u32 range_count, \
+                                   const additional_key_idx_t *key_idx, u32 key_count)
+{
+    if (!hint_context || !buf || !buf_size || !key_idx || !key_count || key_count > ADDITIONAL_KEY_COUNT) return;
 
-        /* Calculate XXHash checksum over the current chunk */
-        /* Since the collision potential in XXHash is considerably higher, we'll use software-based SHA1 calculation as a failsafe if we find a XXHash match */
-        /* We will only proceed if both hashes match */
-        u8 *ptr = (u8*)addr;
-        if (XXH32(ptr, sd_key->key_size, 0) != sd_key->xxhash || SHA1(ptr, sd_key->key_size, hash) != shaSuccess || memcmp(hash, sd_key->hash, SHA1HashSize) != 0) continue;
+    additional_keyinfo_t *keys[ADDITIONAL_KEY_COUNT] = {0};
+    u32 offset = 0, found = 0;
 
-        //printf("Found SD Key at 0x%X\n\n", addr);
-        memcpy(sd_key->key, ptr, sd_key->key_size);
-        sd_key->retrieved = true;
-        break;
+    /* Check hinted offsets first */
+    for(u32 i = 0; i < key_count; i++)
+    {
+        keys[i] = &(additional_keys[key_idx[i]]);
+
+        const char *name = additional_key_hint_names[key_idx[i]];
+        if (name && LookupKeyHint(hint_context, name, &offset) && CheckBufferForKeyAtOffset(buf, buf_size, offset, keys[i])) found++;
     }
+
+    /* Narrow the search down to the provided ranges, if any */
+    if (found < key_count && ranges && range_count) found = ScanBufferRangesForKeys(buf, buf_size, ranges, range_count, keys, key_count);
+
+    /* Fall back to a full sweep if we still haven't found everything */
+    if (found < key_count) ScanBufferForKeys(buf, buf_size, keys, key_count);
+
+    UpdateAdditionalKeyHints(hint_context, key_idx, key_count);
 }
 
-static void RetrieveSystemMenuKeys(void)
+static u32 StreamFileRangeThroughKeyScanner(s32 fd, u8 **chunks, u32 range_offset, u32 range_size, additional_keyinfo_t **keys, u32 key_count)
 {
-    signed_blob *sysmenu_stmd = NULL;
-    u32 sysmenu_stmd_size = 0;
+    keyscan_stream_t stream = {0};
+    isfs_stream_t isfs_stream = {0};
+    u32 offset = ALIGN_DOWN(range_offset, KEYSCAN_STRIDE), found = 0;
+    u8 *chunk = NULL;
+    s32 ret = 0;
 
-    tmd *sysmenu_tmd = NULL;
-    tmd_content *sysmenu_boot_content = NULL;
+    stream.offset = offset;
 
-    char content_path[ISFS_MAXPATH] = {0};
-    u8 *sysmenu_boot_content_data = NULL;
-    u32 sysmenu_boot_content_size = 0;
+    /* The next chunk is read from NAND while we scan the current one. We stop reading as soon as all keys have been found */
+    ret = StartFlashFileSystemStream(&isfs_stream, fd, offset, range_offset + range_size - offset, chunks[0], chunks[1], SYSMENU_CHUNK_SIZE);
+    while(ret >= 0 && found < key_count && (ret = ReadFlashFileSystemStream(&isfs_stream, &chunk)) > 0) found = ScanStreamChunkForKeys(&stream, chunk, (u32)ret, keys, key_count);
 
-    u8 *binary_body = NULL;
+    StopFlashFileSystemStream(&isfs_stream);
 
-    bool priiloader = false;
+    if (ret < 0) StagePrintf("Failed to read System Menu boot content! (%d)\n\n", ret);
 
-    sha1 hash = {0};
+    return found;
+}
 
-    /* Get System Menu TMD */
-    sysmenu_stmd = GetSignedTMDFromTitle(SYSTEM_MENU_TID, &sysmenu_stmd_size);
-    if (!sysmenu_stmd)
+static void RetrieveKeysFromDOLFile(const char *hint_context, s32 fd, u32 file_size, const additional_key_idx_t *key_idx, u32 key_count)
+{
+    if (!hint_context || fd < 0 || !file_size || !key_idx || !key_count || key_count > ADDITIONAL_KEY_COUNT) return;
+
+    additional_keyinfo_t *keys[ADDITIONAL_KEY_COUNT] = {0};
+    keyscan_range_t ranges[DOL_DATA_SECTION_COUNT] = {0};
+    u32 offset = 0, found = 0, range_count = 0;
+
+    /* Two chunk buffers, so one of them can be filled by IOS while the other one is scanned */
+    /* Room for the data the scanner carries over between chunks is reserved right before each one of them */
+    u8 *buf = memalign(32, (KEYSCAN_CARRY_SIZE + SYSMENU_CHUNK_SIZE) * 2);
+    if (!buf)
     {
-        printf("Error retrieving System Menu TMD!\n\n");
+        StagePrintf("Error allocating memory for NAND file chunk buffer.\n\n");
         return;
     }
 
-    sysmenu_tmd = GetTMDFromSignedBlob(sysmenu_stmd);
+    u8 *chunks[2] = { buf + KEYSCAN_CARRY_SIZE, buf + (KEYSCAN_CARRY_SIZE * 2) + SYSMENU_CHUNK_SIZE };
+    u8 *chunk = chunks[0];
 
-    /* Get System Menu TMD boot content entry */
-    sysmenu_boot_content = &(sysmenu_tmd->contents[sysmenu_tmd->boot_index]);
+    /* Check hinted offsets first. We only need to read the aligned block that holds each key */
+    for(u32 i = 0; i < key_count; i++)
+    {
+        keys[i] = &(additional_keys[key_idx[i]]);
+
+        const char *name = additional_key_hint_names[key_idx[i]];
+        if (!name || !LookupKeyHint(hint_context, name, &offset) || offset >= file_size) continue;
+
+        u32 block_offset = ALIGN_DOWN(offset, 32);
+        u32 block_size = (ALIGN_UP(offset + keys[i]->key_size, 32) - block_offset);
+        if (block_size > (file_size - block_offset)) block_size = (file_size - block_offset);
 
-    /* Check for Priiloader */
-    for(u32 i = 0; i < priiloader_files_count; i++)
+        if (ISFS_Seek(fd, block_offset, SEEK_SET) < 0 || ReadFileChunkFromFlashFileSystem(fd, chunk, block_size) != (s32)block_size || \
+            !CheckBufferForKeyAtOffset(chunk, block_size, offset - block_offset, keys[i])) continue;
+
+        keys[i]->offset = offset;
+        found++;
+    }
+
+    /* Narrow the search down to the DOL data sections, if we can parse its header */
+    if (found < key_count && file_size > sizeof(dol_header_t) && ISFS_Seek(fd, 0, SEEK_SET) >= 0 && \
+        ReadFileChunkFromFlashFileSystem(fd, chunk, sizeof(dol_header_t)) == (s32)sizeof(dol_header_t))
     {
-        sprintf(content_path, "/title/%08x/%08x/%s", TITLE_UPPER(SYSTEM_MENU_TID), TITLE_LOWER(SYSTEM_MENU_TID), priiloader_files[i]);
-        if (CheckIfFlashFileSystemFileExists(content_path))
-        {
-            priiloader = true;
-            break;
-        }
+        range_count = GetDOLDataSectionRanges((const dol_header_t*)chunk, file_size, ranges, DOL_DATA_SECTION_COUNT);
     }
 
-    /* Generate boot content path and read it */
-    sprintf(content_path, "/title/%08x/%08x/content/%08x.app", TITLE_UPPER(SYSTEM_MENU_TID), TITLE_LOWER(SYSTEM_MENU_TID), \
-            priiloader ? (0x10000000 | sysmenu_boot_content->cid) : sysmenu_boot_content->cid);
-    sysmenu_boot_content_data = (u8*)ReadFileFromFlashFileSystem(content_path, &sysmenu_boot_content_size);
-    if (!sysmenu_boot_content_data && priiloader)
+    for(u32 i = 0; i < range_count && found < key_count; i++) found = StreamFileRangeThroughKeyScanner(fd, chunks, ranges[i].offset, ranges[i].size, keys, key_count);
+
+    /* Fall back to a full sweep if we still haven't found everything */
+    if (found < key_count) StreamFileRangeThroughKeyScanner(fd, chunks, 0, file_size, keys, key_count);
+
+    UpdateAdditionalKeyHints(hint_context, key_idx, key_count);
+
+    free(buf);
+}
+
+/* IOS drives the AES and SHA engines while servicing NAND requests, so stages hold them off for as long as they may have IOS requests in flight */
+static void HoldCryptoEngines(void)
+{
+    aes_hw_hold();
+    sha_hw_hold();
+}
+
+static void ReleaseCryptoEngines(void)
+{
+    sha_hw_release();
+    aes_hw_release();
+}
+
+static bool DecryptAncastImageBodyArea(const u8 *chunk, u8 *plain, u32 chunk_offset, u32 dec_size, const u8 *prev_block, u32 area_offset, u32 area_size)
+{
+    u32 area_start = (area_offset > chunk_offset ? area_offset : chunk_offset);
+    u32 area_end = ((area_offset + area_size) < (chunk_offset + dec_size) ? (area_offset + area_size) : (chunk_offset + dec_size));
+    if (area_start >= area_end) return true;
+
+    /* Expand the area to AES block boundaries within the current chunk */
+    u32 start = ALIGN_DOWN(area_start - chunk_offset, AES_BLOCK_SIZE), end = ALIGN_UP(area_end - chunk_offset, AES_BLOCK_SIZE);
+
+    /* Decrypt it using baked in vWii Ancast Key (unavoidable...) */
+    return (aes_128_cbc_decrypt_range_ctx(&vwii_ancast_aes_ctx, prev_block, chunk, plain + start, start, end - start) == 0);
+}
+
+static bool ProcessAncastImageBody(s32 fd, u8 **chunks, u8 *plain, u32 body_size, bool dol_data_only, additional_keyinfo_t **keys, const u32 *hint_offsets, \
+                                   const bool *hinted, u32 key_count, sha1 hash, bool *out_full_scan)
+{
+    keyscan_stream_t streams[DOL_DATA_SECTION_COUNT] = {0};
+    keyscan_range_t ranges[DOL_DATA_SECTION_COUNT] = {0};
+    u32 range_count = 0, offset = 0, found = 0, chunk_size = 0;
+
+    isfs_stream_t isfs_stream = {0};
+    u8 *chunk = NULL;
+    s32 ret = 0;
+
+    SHA1Context sha1_ctx = {0};
+    u8 prev_block[AES_BLOCK_SIZE] = {0};
+    bool success = true, use_engines = false, engines_released = false;
+
+    SHA1Reset(&sha1_ctx);
+    memcpy(prev_block, vwii_ancast_iv, AES_BLOCK_SIZE);
+
+    *out_full_scan = !dol_data_only;
+
+    if (!dol_data_only)
     {
-        sprintf(content_path, "/title/%08x/%08x/content/%08x.app", TITLE_UPPER(SYSTEM_MENU_TID), TITLE_LOWER(SYSTEM_MENU_TID), sysmenu_boot_content->cid);
-        sysmenu_boot_content_data = (u8*)ReadFileFromFlashFileSystem(content_path, &sysmenu_boot_content_size);
+        ranges[0].size = body_size;
+        range_count = 1;
     }
 
-    if (!sysmenu_boot_content_data)
+    /* The caller holds the engines off while it talks to IOS. If nobody else is holding them, each chunk is read with a blocking request */
+    /* and the hold is lifted while we work on it, so the engines can hash and decrypt it. Otherwise, the next chunk is read from NAND */
+    /* while we work on the current one in software */
+    ReleaseCryptoEngines();
+    use_engines = (aes_hw_available() || sha_hw_available());
+    HoldCryptoEngines();
+
+    /* Read, hash and scan the ancast image body in a single pass. Encrypted chunks are left untouched, so we only need to decrypt */
+    /* the areas we're actually going to look at. Once all keys have been found, we only keep reading to finish the hash calculation */
+    if (use_engines)
     {
-        printf("Failed to read System Menu boot content data!\n\n");
-        goto out;
+        ret = ISFS_Seek(fd, ANCAST_BODY_OFFSET, SEEK_SET);
+    } else {
+        ret = StartFlashFileSystemStream(&isfs_stream, fd, ANCAST_BODY_OFFSET, body_size, chunks[0], chunks[1], SYSMENU_CHUNK_SIZE);
     }
 
-    if (g_isvWii)
+    for(offset = 0; ret >= 0 && offset < body_size; offset += chunk_size)
     {
-        /* Retrieve a pointer to the PPC Ancast Image header */
-        ppc_ancast_image_header_t *ancast_image_header = (ppc_ancast_image_header_t*)(sysmenu_boot_content_data + 0x500);
-        if (ancast_image_header->magic != ANCAST_HEADER_MAGIC)
+        if (use_engines)
         {
-            printf("Invalid vWii System Menu ancast image header magic word!\n\n");
-            goto out;
+            if (engines_released) HoldCryptoEngines();
+            engines_released = false;
+
+            chunk = chunks[0];
+            chunk_size = ((body_size - offset) < SYSMENU_CHUNK_SIZE ? (body_size - offset) : SYSMENU_CHUNK_SIZE);
+            if (ReadFileChunkFromFlashFileSystem(fd, chunk, chunk_size) != (s32)chunk_size) break;
+
+            /* No IOS requests are in flight until the next chunk is read */
+            ReleaseCryptoEngines();
+            engines_released = true;
+        } else {
+            if ((ret = ReadFlashFileSystemStream(&isfs_stream, &chunk)) <= 0) break;
+
+            chunk_size = (u32)ret;
         }
 
-        /* Set the binary body pointer to the end of the PPC Ancast Image header and update size */
-        binary_body = (sysmenu_boot_content_data + 0x500 + sizeof(ppc_ancast_image_header_t));
-        sysmenu_boot_content_size = ancast_image_header->body_size;
+        /* Feed the encrypted chunk to our SHA-1 context */
+        if (SHA1Input(&sha1_ctx, chunk, chunk_size) != shaSuccess) break;
+
+        u32 dec_size = ALIGN_DOWN(chunk_size, AES_BLOCK_SIZE);
 
-        /* Calculate hash */
-        if (SHA1(binary_body, sysmenu_boot_content_size, hash) != shaSuccess)
+        if (found < key_count && dec_size)
         {
-            printf("Failed to calculate encrypted vWii System Menu ancast image body SHA-1 hash!\n\n");
-            goto out;
+            /* The body holds a plain DOL, so we can get its data section ranges from the first chunk */
+            /* If its header doesn't parse cleanly, the whole body is scanned right away */
+            if (!offset && dol_data_only)
+            {
+                if (dec_size >= sizeof(dol_header_t) && (success = DecryptAncastImageBodyArea(chunk, plain, offset, dec_size, prev_block, 0, sizeof(dol_header_t))))
+                {
+                    range_count = GetDOLDataSectionRanges((const dol_header_t*)plain, body_size, ranges, DOL_DATA_SECTION_COUNT);
+                }
+
+                if (!range_count)
+                {
+                    ranges[0].offset = 0;
+                    ranges[0].size = body_size;
+                    range_count = 1;
+                    *out_full_scan = true;
+                }
+            }
+
+            /* Decrypt the parts of this chunk that overlap with our ranges and hinted offsets */
+            for(u32 i = 0; i < range_count && success; i++)
+            {
+                success = DecryptAncastImageBodyArea(chunk, plain, offset, dec_size, prev_block, ALIGN_DOWN(ranges[i].offset, KEYSCAN_STRIDE), \
+                                                     ranges[i].size + (ranges[i].offset % KEYSCAN_STRIDE));
+            }
+
+            for(u32 i = 0; i < key_count && success; i++)
+            {
+                if (!hinted[i] || keys[i]->retrieved) continue;
+                success = DecryptAncastImageBodyArea(chunk, plain, offset, dec_size, prev_block, hint_offsets[i], keys[i]->key_size);
+            }
+
+            if (!success)
+            {
+                StagePrintf("Failed to decrypt vWii System Menu ancast image body!\n\n");
+                break;
+            }
+
+            /* Check hinted offsets that fall within this chunk before scanning it */
+            for(u32 i = 0; i < key_count; i++)
+            {
+                if (!hinted[i] || keys[i]->retrieved || hint_offsets[i] < offset || (hint_offsets[i] - offset) >= dec_size) continue;
+                if (CheckBufferForKeyAtOffset(plain, dec_size, hint_offsets[i] - offset, keys[i])) keys[i]->offset = hint_offsets[i];
+            }
+
+            found = 0;
+            for(u32 i = 0; i < key_count; i++) found += (keys[i]->retrieved ? 1 : 0);
+
+            /* Scan the parts of this chunk that overlap with our ranges. Each range gets its own stream */
+            for(u32 i = 0; i < range_count && found < key_count; i++)
+            {
+                u32 range_start = ALIGN_DOWN(ranges[i].offset, KEYSCAN_STRIDE), range_end = (ranges[i].offset + ranges[i].size);
+                u32 piece_start = (range_start > offset ? range_start : offset);
+                u32 piece_end = (range_end < (offset + dec_size) ? range_end : (offset + dec_size));
+                if (piece_start >= piece_end) continue;
+
+                /* Streams start at the beginning of their range, which may be located anywhere within the first chunk it overlaps with */
+                if (piece_start == range_start) streams[i].offset = range_start;
+
+                found = ScanStreamChunkForKeys(&(streams[i]), plain + (piece_start - offset), piece_end - piece_start, keys, key_count);
+            }
         }
 
+        /* The last encrypted block from this chunk chains into the next one */
+        if (dec_size) memcpy(prev_block, chunk + dec_size - AES_BLOCK_SIZE, AES_BLOCK_SIZE);
+    }
+
+    if (use_engines)
+    {
+        if (engines_released) HoldCryptoEngines();
+    } else {
+        StopFlashFileSystemStream(&isfs_stream);
+    }
+
+    if (offset < body_size)
+    {
+        if (success) StagePrintf("Failed to process vWii System Menu ancast image body!\n\n");
+        return false;
+    }
+
+    if (SHA1Result(&sha1_ctx, hash) != shaSuccess)
+    {
+        StagePrintf("Failed to calculate vWii System Menu ancast image body SHA-1 hash!\n\n");
+        return false;
+    }
+
+    return true;
+}
+
+static void RetrieveKeysFromAncastImage(const char *hint_context, s32 fd, u32 file_size, const additional_key_idx_t *key_idx, u32 key_count)
+{
+    if (!hint_context || fd < 0 || !file_size || !key_idx || !key_count || key_count > ADDITIONAL_KEY_COUNT) return;
+
+    additional_keyinfo_t *keys[ADDITIONAL_KEY_COUNT] = {0};
+    u32 hint_offsets[ADDITIONAL_KEY_COUNT] = {0};
+    bool hinted[ADDITIONAL_KEY_COUNT] = {0};
+
+    sha1 hash = {0}, body_hash = {0};
+
+    ppc_ancast_image_header_t *ancast_image_header = NULL;
+    u32 body_size = 0, found = 0;
+    bool full_scan = false, success = false;
+
+    /* Encrypted chunks are read into two buffers right after a plaintext buffer of the same size, so IOS can fill one of them while we work on the other */
+    /* Room for the data the scanner carries over between chunks is reserved right before the plaintext buffer, which is padded so the encrypted */
+    /* chunks can be DMA'd to the SHA engine */
+    u8 *buf = memalign(SHA_HW_ALIGNMENT, ALIGN_UP(KEYSCAN_CARRY_SIZE, SHA_HW_ALIGNMENT) + (SYSMENU_CHUNK_SIZE * 3));
+    if (!buf)
+    {
+        StagePrintf("Error allocating memory for NAND file chunk buffer.\n\n");
+        return;
+    }
+
+    u8 *plain = (buf + ALIGN_UP(KEYSCAN_CARRY_SIZE, SHA_HW_ALIGNMENT));
+    u8 *chunks[2] = { plain + SYSMENU_CHUNK_SIZE, plain + (SYSMENU_CHUNK_SIZE * 2) };
+    u8 *chunk = chunks[0];
+
+    /* Read everything up to the end of the PPC Ancast Image header */
+    if (file_size < ANCAST_BODY_OFFSET || ReadFileChunkFromFlashFileSystem(fd, chunk, ANCAST_BODY_OFFSET) != (s32)ANCAST_BODY_OFFSET)
+    {
+        StagePrintf("Failed to read vWii System Menu ancast image header!\n\n");
+        goto out;
+    }
+
+    ancast_image_header = (ppc_ancast_image_header_t*)(chunk + ANCAST_HEADER_OFFSET);
+    if (ancast_image_header->magic != ANCAST_HEADER_MAGIC)
+    {
+        StagePrintf("Invalid vWii System Menu ancast image header magic word!\n\n");
+        goto out;
+    }
+
+    body_size = ancast_image_header->body_size;
+    if (body_size > (file_size - ANCAST_BODY_OFFSET))
+    {
+        StagePrintf("Invalid vWii System Menu ancast image body size!\n\n");
+        goto out;
+    }
+
+    /* Our chunk buffer is about to be reused, so keep a copy of the expected body hash */
+    memcpy(body_hash, ancast_image_header->body_hash, SHA1HashSize);
+
+    for(u32 i = 0; i < key_count; i++)
+    {
+        keys[i] = &(additional_keys[key_idx[i]]);
+
+        const char *name = additional_key_hint_names[key_idx[i]];
+        hinted[i] = (name && LookupKeyHint(hint_context, name, &(hint_offsets[i])));
+    }
+
+    if (!vwii_ancast_aes_ctx_ready)
+    {
+        aes_128_init(&vwii_ancast_aes_ctx, vwii_ancast_key, vwii_ancast_iv, false);
+        vwii_ancast_aes_ctx_ready = true;
+    }
+
+    /* The first pass only scans the DOL data sections. If any key is still missing afterwards, the whole body is processed once more */
+    for(u32 pass = 0; pass < 2; pass++)
+    {
+        if (!ProcessAncastImageBody(fd, chunks, plain, body_size, pass == 0, keys, hint_offsets, hinted, key_count, hash, &full_scan)) goto out;
+
         /* Compare hashes */
-        if (memcmp(hash, ancast_image_header->body_hash, SHA1HashSize) != 0)
+        if (memcmp(hash, body_hash, SHA1HashSize) != 0)
         {
-            printf("Encrypted vWii System Menu ancast image body SHA-1 hash mismatch!\n\n");
+            StagePrintf("Encrypted vWii System Menu ancast image body SHA-1 hash mismatch!\n\n");
             goto out;
         }
 
-        /* Decrypt System Menu binary using baked in vWii Ancast Key and IV (unavoidable...) */
-        if (aes_128_cbc_decrypt(vwii_ancast_key, vwii_ancast_iv, binary_body, sysmenu_boot_content_size) != 0)
+        found = 0;
+        for(u32 i = 0; i < key_count; i++) found += (keys[i]->retrieved ? 1 : 0);
+
+        if (found >= key_count || full_scan) break;
+    }
+
+    success = true;
+
+    UpdateAdditionalKeyHints(hint_context, key_idx, key_count);
+
+out:
+    /* Don't trust any keys retrieved from a body we couldn't verify */
+    if (!success)
+    {
+        for(u32 i = 0; i < key_count; i++)
         {
-            printf("Failed to decrypt vWii System Menu ancast image body!\n\n");
-            goto out;
+            if (!keys[i]) continue;
+            memset(keys[i]->key, 0, sizeof(keys[i]->key));
+            keys[i]->retrieved = false;
         }
-    } else {
-        /* Set the binary body pointer to our allocated buffer */
-        binary_body = sysmenu_boot_content_data;
     }
 
-    /* Retrieve keys */
-    for(u32 offset = 0; offset < sysmenu_boot_content_size; offset += 4)
+    free(buf);
+}
+
+static void RetrieveSDKey(void)
+{
+    char hint_context[KEYHINT_CONTEXT_LENGTH] = {0};
+    const additional_key_idx_t key_idx[] = { ADDITIONAL_KEY_SD_KEY };
+
+    ios_segment_t segments[IOS_MAX_MODULE_SEGMENTS] = {0};
+    keyscan_range_t ranges[IOS_MAX_MODULE_SEGMENTS] = {0};
+    u32 segment_count = 0;
+
+    /* The SD key offset only depends on the currently loaded IOS build */
+    sprintf(hint_context, "%s-IOS%d-v%d", g_isvWii ? "vWii" : "Wii", IOS_GetVersion(), IOS_GetRevision());
+
+    /* The SD key lives within the ES module, so we'll only look at its segments from the currently loaded IOS binary */
+    /* If we can't find them, or if the key isn't there, the whole lookup area is scanned */
+    segment_count = GetIOSModuleSegments(MEM2_IOS_LOOKUP_START, MEM2_IOS_LOOKUP_END, IOS_ES_MODULE_VADDR_START, IOS_ES_MODULE_VADDR_END, segments, IOS_MAX_MODULE_SEGMENTS);
+    for(u32 i = 0; i < segment_count; i++)
+    {
+        ranges[i].offset = (segments[i].addr - MEM2_IOS_LOOKUP_START);
+        ranges[i].size = segments[i].size;
+    }
+
+    /* Look for our key within the currently loaded IOS binary */
+    RetrieveKeysFromBuffer(hint_context, (const void*)MEM2_IOS_LOOKUP_START, MEM2_IOS_LOOKUP_END - MEM2_IOS_LOOKUP_START, ranges, segment_count, \
+                           key_idx, MAX_ELEMENTS(key_idx));
+}
+
+static void RetrieveSystemMenuKeys(void)
+{
+    signed_blob *sysmenu_stmd = NULL;
+    u32 sysmenu_stmd_size = 0;
+
+    tmd *sysmenu_tmd = NULL;
+    tmd_content *sysmenu_boot_content = NULL;
+
+    char content_path[ISFS_MAXPATH] = {0};
+    s32 sysmenu_boot_content_fd = -1;
+    u32 sysmenu_boot_content_size = 0;
+
+    char *content_list = NULL, *data_list = NULL;
+    u32 content_count = 0, data_count = 0;
+
+    char boot_content_name[ISFS_MAXPATH] = {0}, moved_boot_content_name[ISFS_MAXPATH] = {0};
+    const char *boot_content_names[3] = {0};
+    u32 boot_content_name_count = 0, found = 0;
+    bool priiloader = false, opened = false;
+
+    char hint_context[KEYHINT_CONTEXT_LENGTH] = {0};
+    const additional_key_idx_t key_idx[] = { ADDITIONAL_KEY_SD_IV, ADDITIONAL_KEY_MD5_BLANKER };
+
+    /* Get System Menu TMD */
+    sysmenu_stmd = GetSignedTMDFromTitle(SYSTEM_MENU_TID, &sysmenu_stmd_size);
+    if (!sysmenu_stmd)
     {
-        /* Bail out if we have retrieved both keys, or if a read operation could exceed our buffer extents */
-        if ((additional_keys[1].retrieved && additional_keys[2].retrieved) || (sysmenu_boot_content_size - offset) < 16) break;
+        StagePrintf("Error retrieving System Menu TMD!\n\n");
+        return;
+    }
 
-        /* Calculate XXHash checksum over the current chunk */
-        /* Since the collision potential in XXHash is considerably higher, we'll use software-based SHA1 calculation as a failsafe if we find a XXHash match */
-        u32 xxhash = XXH32(binary_body + offset, 16, 0);
-        if ((xxhash != additional_keys[1].xxhash && xxhash != additional_keys[2].xxhash) || SHA1(binary_body + offset, 16, hash) != shaSuccess) continue;
+    sysmenu_tmd = GetTMDFromSignedBlob(sysmenu_stmd);
 
-        /* Determine additional key index based on the calculated SHA1 checksum */
-        u8 idx = 0;
+    /* Get System Menu TMD boot content entry */
+    sysmenu_boot_content = &(sysmenu_tmd->contents[sysmenu_tmd->boot_index]);
 
-        if (!additional_keys[1].retrieved && !memcmp(hash, additional_keys[1].hash, SHA1HashSize))
-        {
-            idx = 1;
-        } else
-        if (!additional_keys[2].retrieved && !memcmp(hash, additional_keys[2].hash, SHA1HashSize))
+    /* The key offsets only depend on the System Menu boot content, which is uniquely identified by its content ID and hash */
+    sprintf(hint_context, "SM-%08X-", sysmenu_boot_content->cid);
+    for(u32 i = 0; i < SHA1HashSize; i++) sprintf(hint_context + strlen(hint_context), "%02X", sysmenu_boot_content->hash[i]);
+
+    /* Priiloader moves the original boot content to a file with the same name, but with the uppermost nibble from its content ID set to 1 */
+    sprintf(boot_content_name, "%08x.app", sysmenu_boot_content->cid);
+    sprintf(moved_boot_content_name, "%08x.app", 0x10000000 | sysmenu_boot_content->cid);
+
+    /* Check for Priiloader. Listing both directories once is way cheaper than opening each one of its files */
+    sprintf(content_path, "/title/%08x/%08x/content", TITLE_UPPER(SYSTEM_MENU_TID), TITLE_LOWER(SYSTEM_MENU_TID));
+    content_list = ListFlashFileSystemDirectory(content_path, &content_count);
+
+    sprintf(content_path, "/title/%08x/%08x/data", TITLE_UPPER(SYSTEM_MENU_TID), TITLE_LOWER(SYSTEM_MENU_TID));
+    data_list = ListFlashFileSystemDirectory(content_path, &data_count);
+
+    for(u32 i = 0; i < MAX_ELEMENTS(priiloader_content_files) && !priiloader; i++) priiloader = IsNameInFlashFileSystemDirectoryList(content_list, content_count, priiloader_content_files[i]);
+    for(u32 i = 0; i < MAX_ELEMENTS(priiloader_data_files) && !priiloader; i++) priiloader = IsNameInFlashFileSystemDirectoryList(data_list, data_count, priiloader_data_files[i]);
+
+    /* Pick the boot content from the same listing. The moved boot content is only tried first if Priiloader has been detected and the file is listed, */
+    /* since a leftover one from an uninstalled Priiloader must not take precedence over the actual boot content */
+    if (priiloader && IsNameInFlashFileSystemDirectoryList(content_list, content_count, moved_boot_content_name)) boot_content_names[boot_content_name_count++] = moved_boot_content_name;
+
+    /* Whatever goes wrong with the moved boot content, the one from the TMD is tried next */
+    boot_content_names[boot_content_name_count++] = boot_content_name;
+
+    /* If we couldn't list the content directory, the moved boot content is only tried after the one from the TMD */
+    if (!content_list) boot_content_names[boot_content_name_count++] = moved_boot_content_name;
+
+    for(u32 i = 0; i < boot_content_name_count && found < MAX_ELEMENTS(key_idx); i++)
+    {
+        /* Generate boot content path and open it */
+        sprintf(content_path, "/title/%08x/%08x/content/%s", TITLE_UPPER(SYSTEM_MENU_TID), TITLE_LOWER(SYSTEM_MENU_TID), boot_content_names[i]);
+        sysmenu_boot_content_fd = OpenFileFromFlashFileSystem(content_path, &sysmenu_boot_content_size);
+        if (sysmenu_boot_content_fd < 0) continue;
+
+        opened = true;
+
+        if (!g_isvWii)
         {
-            idx = 2;
+            /* The boot content is a plain DOL, so we can stream it straight through the key scanner */
+            RetrieveKeysFromDOLFile(hint_context, sysmenu_boot_content_fd, sysmenu_boot_content_size, key_idx, MAX_ELEMENTS(key_idx));
+        } else {
+            /* The boot content is a PPC ancast image with an encrypted DOL, which we hash, decrypt and scan on the fly */
+            RetrieveKeysFromAncastImage(hint_context, sysmenu_boot_content_fd, sysmenu_boot_content_size, key_idx, MAX_ELEMENTS(key_idx));
         }
 
-        if (!idx) continue;
-
-        //printf("Found %s in \"%s\" at 0x%X.\n\n", idx == 1 ? "SD IV" : "MD5 Blanker", content_path, offset);
-        memcpy(additional_keys[idx].key, binary_body + offset, 16);
-        additional_keys[idx].retrieved = true;
+        ISFS_Close(sysmenu_boot_content_fd);
+        sysmenu_boot_content_fd = -1;
 
-        offset += 12;
+        /* Move on to the next candidate if this one couldn't be read or verified, or didn't hold every key */
+        found = 0;
+        for(u32 j = 0; j < MAX_ELEMENTS(key_idx); j++) found += (additional_keys[key_idx[j]].retrieved ? 1 : 0);
     }
 
-out:
-    if (sysmenu_boot_content_data) free(sysmenu_boot_content_data);
+    if (!opened) StagePrintf("Failed to open System Menu boot content!\n\n");
+
+    if (data_list) free(data_list);
+    if (content_list) free(content_list);
     if (sysmenu_stmd) free(sysmenu_stmd);
 }
 
 static void GetMACAddress(void)
 {
-    s32 ret = net_get_mac_address(&(additional_keys[3].key));
+    s32 ret = net_get_mac_address(&(additional_keys[ADDITIONAL_KEY_MAC_ADDRESS].key));
     if (ret >= 0)
     {
         //printf("Got WLAN MAC address.\n\n");
-        additional_keys[3].retrieved = true;
+        additional_keys[ADDITIONAL_KEY_MAC_ADDRESS].retrieved = true;
     } else {
-        printf("net_get_mac_address failed! (%d)\n\n", ret);
+        StagePrintf("net_get_mac_address failed! (%d)\n\n", ret);
     }
 }
 
@@ -543,118 +955,323 @@ static void PrintAllKeys(const otp_t *otp_data, const seeprom_t *seeprom_data, c
     }
 }
 
-int XyzzyGetKeys(void)
+typedef struct {
+    otp_t *otp_data;
+    seeprom_t *seeprom_data;
+    vwii_sram_otp_t *sram_otp;
+    bootmii_keys_bin_t *bootmii_keys;
+    u8 *devcert, *boot0;
+    u16 boot0_size;
+} xyzzy_keys_t;
+
+/* Extraction stages. OTP, SEEPROM, SRAM OTP and boot0 are all read through hardware registers, so they're chained to keep them off each other's toes. */
+/* boot0 in particular is mapped on top of the same SRAM mirror the vWii SRAM OTP is read from, so it must wait for it even if it fails. */
+/* The MEM2 sweeps are CPU-bound, while the System Menu, MAC address and device certificate stages mostly wait on IOS, so they can all overlap. */
+typedef enum {
+    XYZZY_STAGE_OTP = 0,
+    XYZZY_STAGE_SEEPROM,
+    XYZZY_STAGE_BOOTMII_KEYS,
+    XYZZY_STAGE_SRAM_OTP,
+    XYZZY_STAGE_BOOT0,
+    XYZZY_STAGE_ISFS_PATCH,
+    XYZZY_STAGE_SD_KEY,
+    XYZZY_STAGE_SYSTEM_MENU,
+    XYZZY_STAGE_MAC_ADDRESS,
+    XYZZY_STAGE_DEVICE_CERT,
+    XYZZY_STAGE_COUNT
+} xyzzy_stage_idx_t;
+
+static bool OTPStage(void *arg)
 {
-    int ret = 0;
-    FILE *fp = NULL;
-    char ATTRIBUTE_ALIGN(32) path[128] = {0};
-    char *pch = NULL;
+    xyzzy_keys_t *keys = (xyzzy_keys_t*)arg;
+    return FillOTPStruct(&(keys->otp_data));
+}
 
-    otp_t *otp_data = NULL;
-    seeprom_t *seeprom_data = NULL;
-    vwii_sram_otp_t *sram_otp = NULL;
-    bootmii_keys_bin_t *bootmii_keys = NULL;
-    u8 *devcert = NULL, *boot0 = NULL;
-    u16 boot0_size = (!g_isvWii ? BOOT0_RVL_SIZE : BOOT0_WUP_SIZE);
+static bool SEEPROMStage(void *arg)
+{
+    xyzzy_keys_t *keys = (xyzzy_keys_t*)arg;
+    return FillSEEPROMStruct(&(keys->seeprom_data));
+}
 
-    ret = SelectStorageDevice();
-    if (ret == -2) return ret;
-    ret = 0;
+static bool BootMiiKeysStage(void *arg)
+{
+    xyzzy_keys_t *keys = (xyzzy_keys_t*)arg;
+    return FillBootMiiKeysStruct(keys->otp_data, keys->seeprom_data, &(keys->bootmii_keys));
+}
 
-    PrintHeadline();
-    printf("Getting keys, please wait...\n\n");
+static bool SRAMOTPStage(void *arg)
+{
+    xyzzy_keys_t *keys = (xyzzy_keys_t*)arg;
 
-    if (!FillOTPStruct(&otp_data))
+    /* Under vWii, many once-SEEPROM values are fetched from OTP by c2w and stored in the end of IOS SRAM. */
+    keys->sram_otp = memalign(32, SRAM_OTP_SIZE);
+    if (!keys->sram_otp)
     {
-        ret = -1;
-        sleep(2);
-        goto out;
+        StagePrintf("Error allocating memory for vWii SRAM OTP buffer.\n\n");
+        return false;
     }
 
-    if (!g_isvWii)
+    u16 rd = vwii_sram_otp_read(keys->sram_otp, 0, SRAM_OTP_SIZE);
+    if (rd != SRAM_OTP_SIZE)
     {
-        /* Access to the SEEPROM will be disabled in we're running under vWii */
-        if (!FillSEEPROMStruct(&seeprom_data))
-        {
-            ret = -1;
-            sleep(2);
-            goto out;
-        }
+        free(keys->sram_otp);
+        keys->sram_otp = NULL;
+        StagePrintf("vwii_sram_otp_read failed! (%u).\n\n", rd);
+        return false;
+    }
 
-        if (!FillBootMiiKeysStruct(otp_data, seeprom_data, &bootmii_keys))
-        {
-            ret = -1;
-            sleep(2);
-            goto out;
-        }
-    } else {
-        /* Under vWii, many once-SEEPROM values are fetched from OTP by c2w and stored in the end of IOS SRAM. */
-        sram_otp = memalign(32, SRAM_OTP_SIZE);
-        if (sram_otp)
-        {
-            u16 rd = vwii_sram_otp_read(sram_otp, 0, SRAM_OTP_SIZE);
-            if (rd != SRAM_OTP_SIZE)
-            {
-                free(sram_otp);
-                sram_otp = NULL;
-                printf("vwii_sram_otp_read failed! (%u).\n\n", rd);
-            }
-        } else {
-            printf("Error allocating memory for vWii SRAM OTP buffer.\n\n");
-        }
+    return true;
+}
+
+static bool Boot0Stage(void *arg)
+{
+    xyzzy_keys_t *keys = (xyzzy_keys_t*)arg;
+
+    keys->boot0 = memalign(32, keys->boot0_size);
+    if (!keys->boot0)
+    {
+        StagePrintf("Error allocating memory for boot0 buffer.\n\n");
+        return false;
     }
 
+    u16 rd = boot0_read(keys->boot0, 0, keys->boot0_size);
+    if (rd != keys->boot0_size)
+    {
+        free(keys->boot0);
+        keys->boot0 = NULL;
+        StagePrintf("boot0_read failed! (%u).\n\n", rd);
+        return false;
+    }
+
+    return true;
+}
+
+static bool ISFSPatchStage(void *arg)
+{
+    (void)arg;
+
+    if (!PatchNandFsPermissions())
+    {
+        StagePrintf("Failed to patch ISFS access permissions!\n");
+        return false;
+    }
+
+    return true;
+}
+
+static bool SDKeyStage(void *arg)
+{
+    (void)arg;
+
     /* Retrieve SD key from IOS */
     RetrieveSDKey();
 
+    return true;
+}
+
+static bool SystemMenuStage(void *arg)
+{
+    (void)arg;
+
+    /* The ancast image body reader lifts this hold on its own whenever it's not waiting on IOS */
+    HoldCryptoEngines();
+
     /* Initialize filesystem driver */
-    ret = ISFS_Initialize();
-    if (ret >= 0)
+    s32 ret = ISFS_Initialize();
+    if (ret < 0)
     {
-        /* Retrieve keys from System Menu binary */
-        RetrieveSystemMenuKeys();
-
-        /* Deinitialize filesystem driver */
-        ISFS_Deinitialize();
-    } else {
-        printf("ISFS_Initialize failed! (%d)\n\n", ret);
+        ReleaseCryptoEngines();
+        StagePrintf("ISFS_Initialize failed! (%d)\n\n", ret);
+        return false;
     }
 
+    /* Retrieve keys from System Menu binary */
+    RetrieveSystemMenuKeys();
+
+    /* Deinitialize filesystem driver */
+    ISFS_Deinitialize();
+
+    ReleaseCryptoEngines();
+
+    return true;
+}
+
+static bool MACAddressStage(void *arg)
+{
+    (void)arg;
+
     /* Get MAC address */
+    HoldCryptoEngines();
     GetMACAddress();
+    ReleaseCryptoEngines();
 
-    /* Get device certificate */
-    devcert = memalign(32, DEVCERT_BUF_SIZE);
-    if (devcert)
-    {
-        memset(devcert, 42, DEVCERT_BUF_SIZE); // Why... ?
+    return true;
+}
 
-        ret = ES_GetDeviceCert(devcert);
-        if (ret < 0)
-        {
-            free(devcert);
-            devcert = NULL;
-            printf("ES_GetDeviceCert failed! (%d)\n\n", ret);
-        }
-    } else {
-        printf("Error allocating memory for device certificate buffer.\n\n");
+static bool DeviceCertStage(void *arg)
+{
+    xyzzy_keys_t *keys = (xyzzy_keys_t*)arg;
+
+    keys->devcert = memalign(32, DEVCERT_BUF_SIZE);
+    if (!keys->devcert)
+    {
+        StagePrintf("Error allocating memory for device certificate buffer.\n\n");
+        return false;
     }
 
-    /* Get boot0 dump */
-    boot0 = memalign(32, boot0_size);
-    if (boot0)
+    memset(keys->devcert, 42, DEVCERT_BUF_SIZE); // Why... ?
+
+    HoldCryptoEngines();
+    s32 ret = ES_GetDeviceCert(keys->devcert);
+    ReleaseCryptoEngines();
+    if (ret < 0)
     {
-        u16 rd = boot0_read(boot0, 0, boot0_size);
-        if (rd != boot0_size)
-        {
-            free(boot0);
-            boot0 = NULL;
-            printf("boot0_read failed! (%u).\n\n", rd);
+        free(keys->devcert);
+        keys->devcert = NULL;
+        StagePrintf("ES_GetDeviceCert failed! (%d)\n\n", ret);
+        return false;
+    }
+
+    return true;
+}
+
+int XyzzyGetKeys(void)
+{
+    int ret = 0;
+    FILE *fp = NULL;
+    char ATTRIBUTE_ALIGN(32) path[128] = {0};
+    char *pch = NULL;
+
+    xyzzy_keys_t keys = { .boot0_size = (!g_isvWii ? BOOT0_RVL_SIZE : BOOT0_WUP_SIZE) };
+    otp_t *otp_data = NULL;
+    seeprom_t *seeprom_data = NULL;
+    vwii_sram_otp_t *sram_otp = NULL;
+    bootmii_keys_bin_t *bootmii_keys = NULL;
+    u8 *devcert = NULL, *boot0 = NULL;
+    u16 boot0_size = keys.boot0_size;
+
+    /* Stages are started in table order as soon as their dependencies succeed. Their output is printed in table order once all of them are done */
+    stage_t stages[XYZZY_STAGE_COUNT] = {
+        [XYZZY_STAGE_OTP] = {
+            .name = "OTP",
+            .func = OTPStage,
+            .arg = &keys,
+            .deps = 0,
+            .flags = STAGE_FLAG_CRITICAL
+        },
+        [XYZZY_STAGE_SEEPROM] = {
+            .name = "SEEPROM",
+            .func = (!g_isvWii ? SEEPROMStage : NULL),
+            .arg = &keys,
+            .deps = STAGE_DEP(XYZZY_STAGE_OTP),
+            .flags = STAGE_FLAG_CRITICAL
+        },
+        [XYZZY_STAGE_BOOTMII_KEYS] = {
+            .name = "BootMii keys",
+            .func = (!g_isvWii ? BootMiiKeysStage : NULL),
+            .arg = &keys,
+            .deps = STAGE_DEP(XYZZY_STAGE_OTP) | STAGE_DEP(XYZZY_STAGE_SEEPROM),
+            .flags = STAGE_FLAG_CRITICAL
+        },
+        [XYZZY_STAGE_SRAM_OTP] = {
+            .name = "vWii SRAM OTP",
+            .func = (g_isvWii ? SRAMOTPStage : NULL),
+            .arg = &keys,
+            .deps = STAGE_DEP(XYZZY_STAGE_OTP),
+            .flags = STAGE_FLAG_NONE
+        },
+        [XYZZY_STAGE_BOOT0] = {
+            .name = "boot0",
+            .func = Boot0Stage,
+            .arg = &keys,
+            .deps = STAGE_DEP(XYZZY_STAGE_BOOTMII_KEYS),
+            .flags = STAGE_FLAG_NONE,
+            .after = STAGE_DEP(XYZZY_STAGE_SRAM_OTP)
+        },
+        [XYZZY_STAGE_ISFS_PATCH] = {
+            .name = "ISFS patch",
+            .func = ISFSPatchStage,
+            .arg = NULL,
+            .deps = 0,
+            .flags = STAGE_FLAG_CRITICAL
+        },
+        [XYZZY_STAGE_SD_KEY] = {
+            .name = "SD key",
+            .func = SDKeyStage,
+            .arg = NULL,
+            .deps = STAGE_DEP(XYZZY_STAGE_ISFS_PATCH),
+            .flags = STAGE_FLAG_NONE
+        },
+        [XYZZY_STAGE_SYSTEM_MENU] = {
+            .name = "System Menu",
+            .func = SystemMenuStage,
+            .arg = NULL,
+            .deps = STAGE_DEP(XYZZY_STAGE_ISFS_PATCH),
+            .flags = STAGE_FLAG_IPC
+        },
+        [XYZZY_STAGE_MAC_ADDRESS] = {
+            .name = "MAC address",
+            .func = MACAddressStage,
+            .arg = NULL,
+            .deps = 0,
+            .flags = STAGE_FLAG_IPC
+        },
+        [XYZZY_STAGE_DEVICE_CERT] = {
+            .name = "Device cert",
+            .func = DeviceCertStage,
+            .arg = &keys,
+            .deps = 0,
+            .flags = STAGE_FLAG_IPC
         }
-    } else {
-        printf("Error allocating memory for boot0 buffer.\n\n");
+    };
+
+    u64 stages_start = 0, stages_ticks = 0;
+    bool stages_ok = false;
+
+    /* The storage device has to be picked before the ISFS patch is applied, because that's where the "isfs_perm" hint lives. This means */
+    /* an unsupported IOS build is only reported once a device has been picked, but known builds get to skip the MEM2 sweep altogether */
+    ret = SelectStorageDevice();
+    if (ret == -2) return ret;
+    ret = 0;
+
+    PrintHeadline();
+    printf("Getting keys, please wait...\n\n");
+
+    /* Load key offset hints from the storage device. This must happen before any stage runs, since the ISFS patch stage is the only place */
+    /* where ISFS permissions get patched, and it looks up its "isfs_perm" hint first */
+    sprintf(path, "%s:/xyzzy/%s", StorageDeviceMountName(), KEYHINTS_FILENAME);
+    LoadKeyHints(path);
+
+    /* Run all extraction stages. The ones that talk to IOS hold the AES and SHA engines off while they're at it */
+    stages_start = gettime();
+    stages_ok = RunStages(stages, XYZZY_STAGE_COUNT);
+    stages_ticks = diff_ticks(stages_start, gettime());
+
+    /* Take ownership of everything the stages got us */
+    otp_data = keys.otp_data;
+    seeprom_data = keys.seeprom_data;
+    sram_otp = keys.sram_otp;
+    bootmii_keys = keys.bootmii_keys;
+    devcert = keys.devcert;
+    boot0 = keys.boot0;
+
+    PrintStageLogs(stages, XYZZY_STAGE_COUNT, stdout);
+
+#ifdef XYZZY_BENCHMARK
+    PrintStageTimings(stages, XYZZY_STAGE_COUNT, stages_ticks, stdout);
+    printf("\n");
+#endif
+
+    if (!stages_ok)
+    {
+        ret = -1;
+        sleep(2);
+        goto out;
     }
 
+    printf("Keys retrieved in %u ms (%u ms if run sequentially).\n\n", (u32)ticks_to_millisecs(stages_ticks), \
+           (u32)ticks_to_millisecs(GetStagesSequentialTicks(stages, XYZZY_STAGE_COUNT)));
+
     /* Print all keys to stdout */
     PrintAllKeys(otp_data, seeprom_data, sram_otp, stdout);
 
@@ -662,7 +1279,11 @@ int XyzzyGetKeys(void)
     sprintf(path, "%s:/xyzzy", StorageDeviceMountName());
     mkdir(path, 0777);
 
-    sprintf(path + strlen(path), "/%08x", *((u32*)otp_data->ng_id));
+    /* Save key offset hints, if needed */
+    sprintf(path + strlen(path), "/%s", KEYHINTS_FILENAME);
+    SaveKeyHints(path);
+
+    sprintf(path, "%s:/xyzzy/%08x", StorageDeviceMountName(), *((u32*)otp_data->ng_id));
     mkdir(path, 0777);
 
     strcat(path, "/");
@@ -776,6 +1397,8 @@ int XyzzyGetKeys(void)
     }
 
 out:
+    FreeKeyHints();
+
     if (boot0) free(boot0);
 
     if (devcert) free(devcert);